@@ -7,7 +7,11 @@
 #include <zephyr/kernel.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/crypto/crypto.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/sys/byteorder.h>
 #include <stdlib.h>
+#include "test_pattern.h"
+#include "test_timing.h"
 
 LOG_MODULE_REGISTER(main);
 
@@ -417,6 +421,787 @@ static void aes_validation_func(void *dummy1, void *dummy2, void *dummy3)
 	}
 }
 
+/*
+ * Bulk throughput, one session per direction kept open over the run. The
+ * session cost is timed on its own, then calls on one block and on <len>
+ * bytes split the cost of a call into a fixed part and a per-byte part.
+ */
+#define AES_BENCH_MAX_SIZE	KB(16)
+/* Every size is processed until at least this many bytes went through */
+#define AES_BENCH_MIN_BYTES	KB(256)
+#define AES_BENCH_BLOCK_CALLS	256
+#define AES_BENCH_SESSIONS	32
+
+struct aes_mode_info {
+	const char *name;
+	enum cipher_mode mode;
+};
+
+static const struct aes_mode_info aes_modes[] = {
+	{ "ecb", CRYPTO_CIPHER_MODE_ECB },
+	{ "cbc", CRYPTO_CIPHER_MODE_CBC },
+	{ "ctr", CRYPTO_CIPHER_MODE_CTR },
+	{ "gcm", CRYPTO_CIPHER_MODE_GCM },
+};
+
+struct aes_bench_result {
+	uint32_t begin;
+	uint32_t free;
+	/* Average cycles of a one block call and of a <len> byte call */
+	uint32_t block;
+	uint32_t call;
+	uint64_t cycles;
+	uint32_t loops;
+};
+
+static uint8_t aes_bench_plain[AES_BENCH_MAX_SIZE] __aligned(4);
+static uint8_t aes_bench_cipher[AES_BENCH_MAX_SIZE] __aligned(4);
+/* Tags of the one block and the <len> byte message */
+static uint8_t aes_bench_tag[2][AES_BLOCK_SIZE];
+
+static const struct aes_mode_info *aes_mode_from_name(const char *name)
+{
+	for (int i = 0; i < ARRAY_SIZE(aes_modes); i++) {
+		if (!strcmp(aes_modes[i].name, name)) {
+			return &aes_modes[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int aes_crypt(struct cipher_ctx *ctx, uint8_t *in, uint8_t *out, uint32_t len,
+		     uint8_t *tag)
+{
+	struct cipher_pkt pkt = {
+		.in_buf = in,
+		.in_len = len,
+		.out_buf = out,
+		.out_buf_max = len,
+		.ctx = ctx,
+	};
+	struct cipher_aead_pkt aead_pkt = {
+		.pkt = &pkt,
+		.ad = aes_ad,
+		.ad_len = sizeof(aes_ad),
+		.tag = tag,
+	};
+
+	switch (ctx->ops.cipher_mode) {
+	case CRYPTO_CIPHER_MODE_ECB:
+		return ctx->ops.block_crypt_hndlr(ctx, &pkt);
+	case CRYPTO_CIPHER_MODE_CBC:
+		return ctx->ops.cbc_crypt_hndlr(ctx, &pkt, (uint8_t *)aes_iv);
+	case CRYPTO_CIPHER_MODE_CTR:
+		return ctx->ops.ctr_crypt_hndlr(ctx, &pkt, (uint8_t *)aes_iv);
+	case CRYPTO_CIPHER_MODE_GCM:
+		return ctx->ops.gcm_crypt_hndlr(ctx, &aead_pkt, aes_nonce);
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/*
+ * With the same IV or nonce the first block of a <len> byte message is the
+ * one block message, so both directions use the same first block and the
+ * GCM tags of the encryption pass are the right ones for the decryption.
+ */
+static int aes_bench_op(const struct aes_mode_info *info, int keysize, enum cipher_op op,
+			uint8_t *in, uint8_t *out, uint32_t len, struct aes_bench_result *res)
+{
+	struct cipher_ctx ctx;
+	uint32_t start;
+	int ret = 0;
+
+	ctx.mode_params.gcm_info.tag_len = AES_BLOCK_SIZE;
+	ctx.mode_params.gcm_info.nonce_len = sizeof(aes_nonce);
+
+	res->begin = 0;
+	res->free = 0;
+	for (int i = 0; i < AES_BENCH_SESSIONS; i++) {
+		start = test_timing_cycles();
+		ret = aes_setup(&ctx, info->mode, keysize, op);
+		res->begin += test_timing_cycles() - start;
+		if (ret != 0) {
+			return ret;
+		}
+
+		start = test_timing_cycles();
+		cipher_free_session(aes_dev, &ctx);
+		res->free += test_timing_cycles() - start;
+	}
+	res->begin /= AES_BENCH_SESSIONS;
+	res->free /= AES_BENCH_SESSIONS;
+
+	ret = aes_setup(&ctx, info->mode, keysize, op);
+	if (ret != 0) {
+		return ret;
+	}
+
+	start = test_timing_cycles();
+	for (int i = 0; i < AES_BENCH_BLOCK_CALLS && ret == 0; i++) {
+		ret = aes_crypt(&ctx, in, out, AES_BLOCK_SIZE, aes_bench_tag[0]);
+	}
+	res->block = (test_timing_cycles() - start) / AES_BENCH_BLOCK_CALLS;
+
+	res->loops = MAX(1, AES_BENCH_MIN_BYTES / len);
+	start = test_timing_cycles();
+	for (uint32_t i = 0; i < res->loops && ret == 0; i++) {
+		ret = aes_crypt(&ctx, in, out, len, aes_bench_tag[1]);
+	}
+	res->cycles = test_timing_cycles() - start;
+	res->call = res->cycles / res->loops;
+
+	cipher_free_session(aes_dev, &ctx);
+
+	return ret;
+}
+
+static void aes_bench_print(const struct shell *shell, const char *op, uint32_t len,
+			    const struct aes_bench_result *res)
+{
+	uint32_t kbps = test_timing_kbps((uint64_t)len * res->loops, res->cycles);
+	uint32_t cpb = 0, fixed = res->block;
+
+	/* Call cost = fixed + len * per byte, from the one block and the <len> byte calls */
+	if (len > AES_BLOCK_SIZE && res->call > res->block) {
+		cpb = (uint64_t)(res->call - res->block) * 100U / (len - AES_BLOCK_SIZE);
+		fixed = (res->block > AES_BLOCK_SIZE * cpb / 100U) ?
+			res->block - AES_BLOCK_SIZE * cpb / 100U : 0;
+	}
+
+	shell_print(shell, "  %-7s | %7u | %7u | %7u | %5u.%02u | %5u.%03u", op, res->begin,
+		    res->free, fixed, cpb / 100U, cpb % 100U, kbps / 1000U, kbps % 1000U);
+}
+
+static int aes_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	const struct aes_mode_info *info = aes_mode_from_name(argv[1]);
+	struct aes_bench_result enc, dec;
+	uint8_t enc_tag[2][AES_BLOCK_SIZE];
+	uint32_t keysize, len, err_addr;
+	struct test_pattern pat;
+	char *eptr;
+	int ret;
+
+	if (info == NULL) {
+		shell_error(shell, "Invalid argument, '%s' is not ecb/cbc/ctr/gcm", argv[1]);
+		return -EINVAL;
+	}
+
+	keysize = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0' || (keysize != 128 && keysize != 192 && keysize != 256)) {
+		shell_error(shell, "Invalid argument, key length 128/192/256 (%s)", argv[2]);
+		return -EINVAL;
+	}
+
+	len = strtoul(argv[3], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[3]);
+		return -EINVAL;
+	}
+	if (len < AES_BLOCK_SIZE || len > AES_BENCH_MAX_SIZE ||
+	    ((info->mode == CRYPTO_CIPHER_MODE_ECB || info->mode == CRYPTO_CIPHER_MODE_CBC) &&
+	     len % AES_BLOCK_SIZE != 0)) {
+		shell_error(shell, "Invalid argument, length %u - %u, block multiple for ecb/cbc",
+			    AES_BLOCK_SIZE, AES_BENCH_MAX_SIZE);
+		return -EINVAL;
+	}
+
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, 0x5A5A, 0);
+	test_pattern_fill(&pat, aes_bench_plain, len);
+
+	ret = aes_bench_op(info, keysize, CRYPTO_CIPHER_OP_ENCRYPT, aes_bench_plain,
+			   aes_bench_cipher, len, &enc);
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] AES %s-%u encrypt: %d", info->name, keysize, ret);
+		return -EIO;
+	}
+
+	/* Decrypt over the plaintext, it is checked against the pattern after */
+	memcpy(enc_tag, aes_bench_tag, sizeof(enc_tag));
+	/* Clear the tag so a decrypt that never writes it cannot pass */
+	memset(aes_bench_tag, 0, sizeof(aes_bench_tag));
+	ret = aes_bench_op(info, keysize, CRYPTO_CIPHER_OP_DECRYPT, aes_bench_cipher,
+			   aes_bench_plain, len, &dec);
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] AES %s-%u decrypt: %d", info->name, keysize, ret);
+		return -EIO;
+	}
+
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, 0x5A5A, 0);
+	if (test_pattern_verify(&pat, aes_bench_plain, len, &err_addr) != 0) {
+		shell_error(shell, "[FAIL] Decrypted data differs at 0x%x", err_addr);
+		return -EIO;
+	}
+	if (info->mode == CRYPTO_CIPHER_MODE_GCM &&
+	    memcmp(enc_tag, aes_bench_tag, sizeof(enc_tag)) != 0) {
+		shell_error(shell, "[FAIL] Decryption tag differs");
+		return -EIO;
+	}
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "aes %s-%u bench, %u bytes, host cycles", info->name, keysize, len);
+#else
+	shell_print(shell, "aes %s-%u bench, %u bytes, cycles (%u Hz)", info->name, keysize, len,
+		    sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "  %-7s | %7s | %7s | %7s | %8s | %9s", "op", "begin", "free", "call",
+		    "cyc/B", "MB/s");
+	aes_bench_print(shell, "encrypt", len, &enc);
+	aes_bench_print(shell, "decrypt", len, &dec);
+
+	shell_info(shell, "[PASS] AES bench succeeded!");
+	shell_info(shell, "[GO]");
+
+	return 0;
+}
+
+/*
+ * Streaming AES-GCM. The cipher API only has one shot GCM, so the stream is
+ * built from the ECB handler: the key stream is the encrypted counter blocks,
+ * GHASH runs in software with 4-bit tables. AAD and payload go through in
+ * fixed size segments, from RAM in place or from flash through a segment
+ * buffer, and the tag is only known and checked after the last one.
+ */
+#define AES_GCM_SEG_MIN		AES_BLOCK_SIZE
+#define AES_GCM_SEG_MAX		KB(2)
+#define AES_GCM_FLASH_NODE	DT_ALIAS(spi_flash0)
+#define AES_GCM_FLASH_ERASE	KB(4)
+
+struct aes_gcm_stream {
+	/* ECB session for H, E(J0) and the key stream */
+	struct cipher_ctx ctx;
+	/* Multiples of H by every 4-bit value, high and low halves */
+	uint64_t hh[16];
+	uint64_t hl[16];
+	uint8_t ctr[AES_BLOCK_SIZE];
+	uint8_t ek_j0[AES_BLOCK_SIZE];
+	uint8_t y[AES_BLOCK_SIZE];
+	uint64_t aad_len;
+	uint64_t len;
+};
+
+static uint8_t aes_gcm_ctr_blocks[AES_GCM_SEG_MAX] __aligned(4);
+static uint8_t aes_gcm_key_stream[AES_GCM_SEG_MAX] __aligned(4);
+static uint8_t aes_gcm_seg[AES_GCM_SEG_MAX] __aligned(4);
+
+#if DT_NODE_HAS_STATUS(AES_GCM_FLASH_NODE, okay)
+static const struct device *const aes_gcm_flash = DEVICE_DT_GET(AES_GCM_FLASH_NODE);
+#else
+static const struct device *const aes_gcm_flash;
+#endif
+
+/* Reduction of the 4 bits shifted out of the low end */
+static const uint64_t aes_gcm_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+static void aes_gcm_table(struct aes_gcm_stream *st, const uint8_t *h)
+{
+	uint64_t vh = sys_get_be64(h);
+	uint64_t vl = sys_get_be64(&h[8]);
+	uint64_t t;
+
+	st->hh[0] = 0;
+	st->hl[0] = 0;
+	st->hh[8] = vh;
+	st->hl[8] = vl;
+
+	/* H times x, x^2 and x^3 go to indexes 4, 2 and 1 in the bit reflected field */
+	for (int i = 4; i > 0; i >>= 1) {
+		t = (vl & 1) * 0xe1000000U;
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ (t << 32);
+		st->hh[i] = vh;
+		st->hl[i] = vl;
+	}
+
+	for (int i = 2; i <= 8; i *= 2) {
+		for (int j = 1; j < i; j++) {
+			st->hh[i + j] = st->hh[i] ^ st->hh[j];
+			st->hl[i + j] = st->hl[i] ^ st->hl[j];
+		}
+	}
+}
+
+/* y = y * H */
+static void aes_gcm_mult(struct aes_gcm_stream *st, uint8_t *y)
+{
+	uint8_t lo = y[15] & 0xf, hi, rem;
+	uint64_t zh = st->hh[lo];
+	uint64_t zl = st->hl[lo];
+
+	for (int i = 15; i >= 0; i--) {
+		lo = y[i] & 0xf;
+		hi = y[i] >> 4;
+
+		if (i != 15) {
+			rem = zl & 0xf;
+			zl = (zh << 60) | (zl >> 4);
+			zh = (zh >> 4) ^ (aes_gcm_last4[rem] << 48) ^ st->hh[lo];
+			zl ^= st->hl[lo];
+		}
+
+		rem = zl & 0xf;
+		zl = (zh << 60) | (zl >> 4);
+		zh = (zh >> 4) ^ (aes_gcm_last4[rem] << 48) ^ st->hh[hi];
+		zl ^= st->hl[hi];
+	}
+
+	sys_put_be64(zh, y);
+	sys_put_be64(zl, &y[8]);
+}
+
+/* Only the last piece of the AAD or of the payload may end in a partial block */
+static void aes_gcm_ghash(struct aes_gcm_stream *st, const uint8_t *buf, size_t len)
+{
+	size_t n;
+
+	for (; len > 0; buf += n, len -= n) {
+		n = MIN(len, AES_BLOCK_SIZE);
+		for (size_t i = 0; i < n; i++) {
+			st->y[i] ^= buf[i];
+		}
+		aes_gcm_mult(st, st->y);
+	}
+}
+
+static int aes_gcm_ecb(struct aes_gcm_stream *st, uint8_t *in, uint8_t *out, uint32_t len)
+{
+	struct cipher_pkt pkt = {
+		.in_buf = in,
+		.in_len = len,
+		.out_buf = out,
+		.out_buf_max = len,
+		.ctx = &st->ctx,
+	};
+
+	return st->ctx.ops.block_crypt_hndlr(&st->ctx, &pkt);
+}
+
+static int aes_gcm_start(struct aes_gcm_stream *st, int keysize, const uint8_t *nonce,
+			 uint32_t nonce_len)
+{
+	uint8_t h[AES_BLOCK_SIZE] = {0};
+	uint8_t len_blk[AES_BLOCK_SIZE] = {0};
+	int ret;
+
+	ret = aes_setup(&st->ctx, CRYPTO_CIPHER_MODE_ECB, keysize, CRYPTO_CIPHER_OP_ENCRYPT);
+	if (ret != 0) {
+		return ret;
+	}
+
+	/* H = E(0) */
+	memcpy(aes_gcm_ctr_blocks, h, sizeof(h));
+	ret = aes_gcm_ecb(st, aes_gcm_ctr_blocks, h, sizeof(h));
+	if (ret != 0) {
+		cipher_free_session(aes_dev, &st->ctx);
+		return ret;
+	}
+	aes_gcm_table(st, h);
+
+	/* J0 is nonce || 1 for a 96-bit nonce, else GHASH(nonce || len) */
+	memset(st->y, 0, sizeof(st->y));
+	if (nonce_len == 12) {
+		memcpy(st->ctr, nonce, nonce_len);
+		sys_put_be32(1, &st->ctr[12]);
+	} else {
+		aes_gcm_ghash(st, nonce, nonce_len);
+		sys_put_be64((uint64_t)nonce_len * 8U, &len_blk[8]);
+		aes_gcm_ghash(st, len_blk, sizeof(len_blk));
+		memcpy(st->ctr, st->y, sizeof(st->ctr));
+		memset(st->y, 0, sizeof(st->y));
+	}
+
+	memcpy(aes_gcm_ctr_blocks, st->ctr, sizeof(st->ctr));
+	ret = aes_gcm_ecb(st, aes_gcm_ctr_blocks, st->ek_j0, sizeof(st->ek_j0));
+	if (ret != 0) {
+		cipher_free_session(aes_dev, &st->ctx);
+		return ret;
+	}
+
+	st->aad_len = 0;
+	st->len = 0;
+
+	return 0;
+}
+
+static void aes_gcm_aad(struct aes_gcm_stream *st, const uint8_t *buf, uint32_t len)
+{
+	aes_gcm_ghash(st, buf, len);
+	st->aad_len += len;
+}
+
+/* En/decrypt in place, up to AES_GCM_SEG_MAX bytes */
+static int aes_gcm_crypt(struct aes_gcm_stream *st, enum cipher_op op, uint8_t *buf,
+			 uint32_t len)
+{
+	uint32_t blocks = DIV_ROUND_UP(len, AES_BLOCK_SIZE);
+	int ret;
+
+	for (uint32_t i = 0; i < blocks; i++) {
+		sys_put_be32(sys_get_be32(&st->ctr[12]) + 1, &st->ctr[12]);
+		memcpy(&aes_gcm_ctr_blocks[i * AES_BLOCK_SIZE], st->ctr, AES_BLOCK_SIZE);
+	}
+
+	ret = aes_gcm_ecb(st, aes_gcm_ctr_blocks, aes_gcm_key_stream, blocks * AES_BLOCK_SIZE);
+	if (ret != 0) {
+		return ret;
+	}
+
+	/* GHASH always runs over the ciphertext */
+	if (op == CRYPTO_CIPHER_OP_DECRYPT) {
+		aes_gcm_ghash(st, buf, len);
+	}
+	for (uint32_t i = 0; i < len; i++) {
+		buf[i] ^= aes_gcm_key_stream[i];
+	}
+	if (op == CRYPTO_CIPHER_OP_ENCRYPT) {
+		aes_gcm_ghash(st, buf, len);
+	}
+	st->len += len;
+
+	return 0;
+}
+
+static void aes_gcm_finish(struct aes_gcm_stream *st, uint8_t *tag)
+{
+	uint8_t len_blk[AES_BLOCK_SIZE];
+
+	sys_put_be64(st->aad_len * 8U, len_blk);
+	sys_put_be64(st->len * 8U, &len_blk[8]);
+	aes_gcm_ghash(st, len_blk, sizeof(len_blk));
+
+	for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+		tag[i] = st->ek_j0[i] ^ st->y[i];
+	}
+
+	cipher_free_session(aes_dev, &st->ctx);
+}
+
+struct aes_gcm_job {
+	/* Blob is AAD || ciphertext, in aes_bench_cipher or in flash at addr */
+	const struct device *dev;
+	uint32_t addr;
+	uint32_t aad_len;
+	uint32_t len;
+	uint32_t seg;
+	/* Flip a bit of the first ciphertext byte as it is read */
+	bool tamper;
+};
+
+/*
+ * Decrypt the blob segment by segment and check the tag at the end, -EBADMSG
+ * when it differs. Flash segments are decrypted in the segment buffer and
+ * compared with the plaintext there, RAM ones in place.
+ */
+static int aes_gcm_stream_decrypt(struct aes_gcm_stream *st, const struct aes_gcm_job *job,
+				  const uint8_t *tag)
+{
+	uint8_t calc[AES_BLOCK_SIZE], diff = 0;
+	uint32_t off, n;
+	uint8_t *buf;
+	int ret = 0;
+
+	for (off = 0; off < job->aad_len && ret == 0; off += n) {
+		n = MIN(job->seg, job->aad_len - off);
+		if (job->dev == NULL) {
+			buf = &aes_bench_cipher[off];
+		} else {
+			buf = aes_gcm_seg;
+			ret = flash_read(job->dev, job->addr + off, buf, n);
+		}
+		aes_gcm_aad(st, buf, n);
+	}
+
+	for (off = 0; off < job->len && ret == 0; off += n) {
+		n = MIN(job->seg, job->len - off);
+		if (job->dev == NULL) {
+			buf = &aes_bench_cipher[job->aad_len + off];
+		} else {
+			buf = aes_gcm_seg;
+			ret = flash_read(job->dev, job->addr + job->aad_len + off, buf, n);
+			if (ret != 0) {
+				break;
+			}
+		}
+		if (job->tamper && off == 0) {
+			buf[0] ^= 0x01;
+		}
+		ret = aes_gcm_crypt(st, CRYPTO_CIPHER_OP_DECRYPT, buf, n);
+		if (ret == 0 && job->dev != NULL && !job->tamper &&
+		    memcmp(buf, &aes_bench_plain[job->aad_len + off], n) != 0) {
+			ret = -EIO;
+		}
+	}
+
+	if (ret != 0) {
+		cipher_free_session(aes_dev, &st->ctx);
+		return ret;
+	}
+
+	aes_gcm_finish(st, calc);
+	for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+		diff |= calc[i] ^ tag[i];
+	}
+
+	return diff ? -EBADMSG : 0;
+}
+
+/* Encrypt the RAM blob back in place, which also gives the tag of the stream */
+static int aes_gcm_stream_encrypt(struct aes_gcm_stream *st, const struct aes_gcm_job *job,
+				  uint8_t *tag)
+{
+	uint32_t off, n;
+	int ret = 0;
+
+	for (off = 0; off < job->aad_len; off += n) {
+		n = MIN(job->seg, job->aad_len - off);
+		aes_gcm_aad(st, &aes_bench_cipher[off], n);
+	}
+
+	for (off = 0; off < job->len && ret == 0; off += n) {
+		n = MIN(job->seg, job->len - off);
+		ret = aes_gcm_crypt(st, CRYPTO_CIPHER_OP_ENCRYPT,
+				    &aes_bench_cipher[job->aad_len + off], n);
+	}
+
+	if (ret != 0) {
+		cipher_free_session(aes_dev, &st->ctx);
+		return ret;
+	}
+	aes_gcm_finish(st, tag);
+
+	return 0;
+}
+
+/* One shot GCM in hardware, the reference blob and tag */
+static int aes_gcm_reference(int keysize, uint32_t aad_len, uint32_t len, uint8_t *tag)
+{
+	struct cipher_ctx ctx;
+	struct cipher_pkt pkt = {
+		.in_buf = &aes_bench_plain[aad_len],
+		.in_len = len,
+		.out_buf = &aes_bench_cipher[aad_len],
+		.out_buf_max = len,
+		.ctx = &ctx,
+	};
+	struct cipher_aead_pkt aead_pkt = {
+		.pkt = &pkt,
+		.ad = aes_bench_plain,
+		.ad_len = aad_len,
+		.tag = tag,
+	};
+	int ret;
+
+	ctx.mode_params.gcm_info.tag_len = AES_BLOCK_SIZE;
+	ctx.mode_params.gcm_info.nonce_len = sizeof(aes_nonce);
+	ret = aes_setup(&ctx, CRYPTO_CIPHER_MODE_GCM, keysize, CRYPTO_CIPHER_OP_ENCRYPT);
+	if (ret != 0) {
+		return ret;
+	}
+
+	ret = ctx.ops.gcm_crypt_hndlr(&ctx, &aead_pkt, aes_nonce);
+	cipher_free_session(aes_dev, &ctx);
+	memcpy(aes_bench_cipher, aes_bench_plain, aad_len);
+
+	return ret;
+}
+
+/* Put the blob in flash, like an image written by the host */
+static int aes_gcm_stage(const struct aes_gcm_job *job)
+{
+	uint32_t size = job->aad_len + job->len;
+	int ret;
+
+	ret = flash_erase(job->dev, job->addr, ROUND_UP(size, AES_GCM_FLASH_ERASE));
+	if (ret != 0) {
+		return ret;
+	}
+
+	return flash_write(job->dev, job->addr, aes_bench_cipher, size);
+}
+
+static int aes_gcm_stream_cmd(const struct shell *shell, size_t argc, char **argv)
+{
+	struct aes_gcm_job job = { 0 };
+	struct aes_gcm_stream st;
+	uint8_t tag[AES_BLOCK_SIZE], enc_tag[AES_BLOCK_SIZE];
+	uint32_t keysize, start, setup, cycles, kbps;
+	struct test_pattern pat;
+	char *eptr;
+	int ret;
+
+	if (!strcmp(argv[1], "flash")) {
+		job.dev = aes_gcm_flash;
+		if (job.dev == NULL) {
+			shell_error(shell, "No spi-flash0 alias on this board");
+			return -ENODEV;
+		}
+	} else if (strcmp(argv[1], "ram")) {
+		shell_error(shell, "Invalid argument, '%s' is not ram/flash", argv[1]);
+		return -EINVAL;
+	}
+
+	keysize = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0' || (keysize != 128 && keysize != 192 && keysize != 256)) {
+		shell_error(shell, "Invalid argument, key length 128/192/256 (%s)", argv[2]);
+		return -EINVAL;
+	}
+
+	job.aad_len = strtoul(argv[3], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[3]);
+		return -EINVAL;
+	}
+
+	job.len = strtoul(argv[4], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[4]);
+		return -EINVAL;
+	}
+	if (job.len == 0 || job.aad_len > AES_BENCH_MAX_SIZE ||
+	    job.aad_len + job.len > AES_BENCH_MAX_SIZE) {
+		shell_error(shell, "Invalid argument, 1 <= aad + len <= %u", AES_BENCH_MAX_SIZE);
+		return -EINVAL;
+	}
+
+	/* The blob is erased and written there, so never pick a default */
+	if (job.dev != NULL) {
+		uint64_t flash_size;
+
+		if (argc < 6) {
+			shell_error(shell, "Flash needs [addr], the area there is erased");
+			return -EINVAL;
+		}
+
+		job.addr = strtoul(argv[5], &eptr, 0);
+		if (*eptr != '\0' || job.addr % AES_GCM_FLASH_ERASE != 0) {
+			shell_error(shell, "Invalid argument, '%s' is not a %u aligned address",
+				    argv[5], AES_GCM_FLASH_ERASE);
+			return -EINVAL;
+		}
+
+		if (!device_is_ready(job.dev)) {
+			shell_error(shell, "%s is not ready", job.dev->name);
+			return -ENODEV;
+		}
+
+		ret = flash_get_size(job.dev, &flash_size);
+		if (ret != 0) {
+			shell_error(shell, "Failed to get %s size: %d", job.dev->name, ret);
+			return -EIO;
+		}
+		if ((uint64_t)job.addr + ROUND_UP(job.aad_len + job.len, AES_GCM_FLASH_ERASE) >
+		    flash_size) {
+			shell_error(shell, "Invalid argument, 0x%x + %u is past the %u KB flash",
+				    job.addr, job.aad_len + job.len, (uint32_t)(flash_size / 1024));
+			return -EINVAL;
+		}
+	}
+
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, 0xA5A5, 0);
+	test_pattern_fill(&pat, aes_bench_plain, job.aad_len + job.len);
+
+	ret = aes_gcm_reference(keysize, job.aad_len, job.len, tag);
+	if (ret == 0 && job.dev != NULL) {
+		ret = aes_gcm_stage(&job);
+	}
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] Failed to prepare the blob: %d", ret);
+		return -EIO;
+	}
+
+	start = test_timing_cycles();
+	ret = aes_gcm_start(&st, keysize, aes_nonce, sizeof(aes_nonce));
+	setup = test_timing_cycles() - start;
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] Failed to init ECB session: %d", ret);
+		return -EIO;
+	}
+	cipher_free_session(aes_dev, &st.ctx);
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "aes gcm-%u stream from %s, aad %u + %u bytes, host cycles", keysize,
+		    argv[1], job.aad_len, job.len);
+#else
+	shell_print(shell, "aes gcm-%u stream from %s, aad %u + %u bytes, cycles (%u Hz)",
+		    keysize, argv[1], job.aad_len, job.len, sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "Setup: %u cycles", setup);
+	shell_print(shell, "  %7s | %10s | %9s", "segment", "cycles", "MB/s");
+
+	for (job.seg = AES_GCM_SEG_MIN; job.seg <= AES_GCM_SEG_MAX; job.seg *= 2) {
+		ret = aes_gcm_start(&st, keysize, aes_nonce, sizeof(aes_nonce));
+		if (ret != 0) {
+			break;
+		}
+
+		start = test_timing_cycles();
+		ret = aes_gcm_stream_decrypt(&st, &job, tag);
+		cycles = test_timing_cycles() - start;
+		if (ret != 0) {
+			shell_error(shell, "[FAIL] %u byte segments: %d", job.seg, ret);
+			break;
+		}
+
+		if (job.dev == NULL) {
+			if (memcmp(&aes_bench_cipher[job.aad_len], &aes_bench_plain[job.aad_len],
+				   job.len) != 0) {
+				shell_error(shell, "[FAIL] %u byte segments: plaintext differs",
+					    job.seg);
+				ret = -EIO;
+				break;
+			}
+
+			/* Back to the ciphertext for the next segment size */
+			ret = aes_gcm_start(&st, keysize, aes_nonce, sizeof(aes_nonce));
+			if (ret == 0) {
+				ret = aes_gcm_stream_encrypt(&st, &job, enc_tag);
+			}
+			if (ret == 0 && memcmp(enc_tag, tag, sizeof(tag)) != 0) {
+				ret = -EBADMSG;
+			}
+			if (ret != 0) {
+				shell_error(shell, "[FAIL] %u byte segments encrypt: %d", job.seg,
+					    ret);
+				break;
+			}
+		}
+
+		kbps = test_timing_kbps(job.aad_len + job.len, cycles);
+		shell_print(shell, "  %7u | %10u | %5u.%03u", job.seg, cycles, kbps / 1000U,
+			    kbps % 1000U);
+	}
+
+	/* A blob changed in one bit has to be rejected */
+	if (ret == 0) {
+		job.seg = AES_GCM_SEG_MAX;
+		job.tamper = true;
+		ret = aes_gcm_start(&st, keysize, aes_nonce, sizeof(aes_nonce));
+		if (ret == 0) {
+			ret = aes_gcm_stream_decrypt(&st, &job, tag);
+		}
+		if (ret != -EBADMSG) {
+			shell_error(shell, "[FAIL] Tampered blob not rejected: %d", ret);
+			return -EIO;
+		}
+		ret = 0;
+	}
+
+	if (ret != 0) {
+		return -EIO;
+	}
+
+	shell_print(shell, "Tag verified at every segment size, tampered blob rejected");
+	shell_info(shell, "[PASS] AES GCM stream succeeded!");
+	shell_info(shell, "[GO]");
+
+	return 0;
+}
+
 int main(void)
 {
 	/* Zephyr driver validation */
@@ -446,6 +1231,12 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_aes,
 	SHELL_CMD_ARG(cbc, NULL, "aes cbc key_length", aes_command, 2, 0),
 	SHELL_CMD_ARG(ctr, NULL, "aes ctr key_length", aes_command, 2, 0),
 	SHELL_CMD_ARG(gcm, NULL, "aes gcm key_length", aes_command, 2, 0),
+	SHELL_CMD_ARG(bench, NULL, "aes bench <ecb/cbc/ctr/gcm> <key_length> <len>: throughput",
+		aes_bench, 4, 0),
+	SHELL_CMD_ARG(gcm_stream, NULL,
+		"aes gcm_stream <ram/flash> <key_length> <aad_len> <len> [addr]: chunked AEAD,"
+		" addr is required for flash and erased",
+		aes_gcm_stream_cmd, 5, 1),
 	SHELL_SUBCMD_SET_END /* Array terminated. */
 );
 
@@ -6,10 +6,15 @@
 #include <stdlib.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/dma.h>
+#ifdef CONFIG_SOC_FAMILY_NPCX
 #include <zephyr/../../drivers/dma/dma_npcx.h>
+#endif
 #include <zephyr/kernel.h>
 #include <zephyr/shell/shell.h>
 
+#include "test_pattern.h"
+#include "test_timing.h"
+
 #define LOG_LEVEL LOG_LEVEL_INF
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(main);
@@ -22,9 +27,7 @@ LOG_MODULE_REGISTER(main);
 #define PRIORITY	7
 
 #define DMA0_CTLER			DT_NODELABEL(dma0)
-#ifdef CONFIG_SOC_SERIES_NPCX4
 #define DMA1_CTLER			DT_NODELABEL(dma1)
-#endif
 
 static uint8_t arguments[MAX_ARGUMNETS][MAX_ARGU_SIZE];
 struct k_event dma_event;
@@ -37,12 +40,13 @@ const struct shell *sh_ptr;
 /* Get device from device tree */
 static const struct device *const dma_devices[] = {
 	DEVICE_DT_GET(DMA0_CTLER),
-	#ifdef CONFIG_SOC_SERIES_NPCX4
+	#if DT_NODE_HAS_STATUS(DMA1_CTLER, okay)
 	DEVICE_DT_GET(DMA1_CTLER),
 	#endif
 };
 
 #define NUM_DMA_DEVICE ARRAY_SIZE(dma_devices)
+#ifdef CONFIG_SOC_FAMILY_NPCX
 #define MRAM				0x100B0000	/* buttom of code ram */
 #ifdef CONFIG_SOC_SERIES_NPCK3
 	#define	INT_FLASH_BASE1_ADDR	0x60000000	/* private flash */
@@ -52,6 +56,7 @@ static const struct device *const dma_devices[] = {
 	#define INT_FLASH_BASE1_ADDR	0x60000000	/* private flash */
 	#define FLASH_BASE1_ADDR	0x68000000	/* external flash */
 #endif
+#endif
 
 /* data transfer config */
 static const uint8_t align_val = 16;
@@ -62,6 +67,7 @@ static struct dma_block_config dma_block_cfg = { 0 };
 static struct dma_config dma_cfg1 = { 0 };
 static struct dma_block_config dma_block_cfg1 = { 0 };
 
+#ifdef CONFIG_SOC_FAMILY_NPCX
 /* mem to mem config */
 static uint8_t GDMAMemPool[MOVE_SIZE + 4] __aligned(16);
 /* power save config */
@@ -180,22 +186,37 @@ static uint32_t gdma_data_check(const struct device *dev, const uint8_t channel)
 	}
 	return tcnt;
 }
+#endif
+
+struct stress_chan;
+static void dma_stress_complete(struct stress_chan *sc, int status);
 
 static void cb_data_check(const struct device *dma_dev, void *arg,
 				uint32_t channel, int status)
 {
+	/* Stress transfers carry their channel context, keep the ISR path short */
+	if (arg != NULL) {
+		dma_stress_complete(arg, status);
+		return;
+	}
+
 	if (status < 0) {
 		LOG_INF("DMA could not proceed, an error occurred\n");
 	}
 	LOG_INF("channel : %d", channel);
 
+#ifdef CONFIG_SOC_FAMILY_NPCX
 	if (gdma_data_check(dma_dev, channel)) {
+#else
+	if (status < 0) {
+#endif
 		LOG_INF("[FAIL] Data check");
 	} else {
 		LOG_INF("[PASS] Data check");
 	}
 }
 
+#ifdef CONFIG_SOC_FAMILY_NPCX
 static void cb_power_save(const struct device *dma_dev, void *arg,
 				uint32_t channel, int status)
 {
@@ -212,6 +233,7 @@ static void cb_power_save(const struct device *dma_dev, void *arg,
 		LOG_INF("[FAIL][GDMA]: ch-%d power save failed.", channel);
 	}
 }
+#endif
 #ifdef CONFIG_SOC_SERIES_NPCK3
 static void cb_gdmaerr(const struct device *dma_dev, void *arg,
 				uint32_t channel, int status)
@@ -262,6 +284,7 @@ static void check_char_data(const char *tx_d, const char *rx_d, bool enable)
 	}
 }
 
+#ifdef CONFIG_SOC_FAMILY_NPCX
 static void check_def_value(const struct shell *shell, size_t argc, char **argv)
 {
 	const uint32_t dma_base = get_dev_base(dev);
@@ -280,23 +303,19 @@ static void check_def_value(const struct shell *shell, size_t argc, char **argv)
 		LOG_INF("[PASS]Default value");
 	}
 }
+#endif
+
 static void dma_init(char *dev_num, char *ch_num)
 {
 	uint8_t dev_n = atoi(dev_num);
 	uint8_t ch_n = atoi(ch_num);
-	#ifdef CONFIG_SOC_SERIES_NPCX4
-	if (dev_n < 2) {
+	if (dev_n < NUM_DMA_DEVICE) {
 		dev = (void *)dma_devices[dev_n];
-	} else {
+	} else if (NUM_DMA_DEVICE == 2) {
 		LOG_ERR("Only device 0/1 available");
-	}
-	#else
-	if (dev_n == 0) {
-		dev = (void *)dma_devices[dev_n];
 	} else {
 		LOG_ERR("Only device 0 available");
 	}
-	#endif
 	if (ch_n < 2) {
 		ch = ch_n;
 	} else {
@@ -304,8 +323,7 @@ static void dma_init(char *dev_num, char *ch_num)
 	}
 }
 
-
-
+#ifdef CONFIG_SOC_FAMILY_NPCX
 int *npcx_power_down_gpd(const struct device *dev, const uint32_t channel,
 					uint32_t val0, uint32_t val1)
 {
@@ -403,6 +421,7 @@ static void npcx_power_save(const struct shell *shell, size_t argc, char **argv)
 	}
 	dma_set_power_save(dev, ch, DISABLE);
 }
+#endif
 
 /* base on chan_blen_transfer */
 static void dma_api_example(const struct shell *shell, size_t argc, char **argv)
@@ -439,6 +458,7 @@ static void dma_api_example(const struct shell *shell, size_t argc, char **argv)
 	check_char_data(tx_data, rx_data, 1);
 }
 
+#ifdef CONFIG_SOC_FAMILY_NPCX
 static void dam_flash_to_ram(const struct shell *shell, size_t argc, char **argv)
 {
 	uint8_t opt = strtoul(argv[1], NULL, 0);
@@ -512,6 +532,8 @@ static void dam_ram_to_ram(const struct shell *shell, size_t argc, char **argv)
 		return;
 	}
 }
+#endif
+
 /* try use thread to implement parallel */
 static void sync_data_transfer(const struct shell *shell, size_t argc, char **argv)
 {
@@ -603,6 +625,779 @@ static void sync_data_transfer(const struct shell *shell, size_t argc, char **ar
 	check_char_data(tx_da1, rx_da1, 1);
 }
 
+/* Throughput and latency benchmark */
+#define BENCH_MIN_SIZE		16
+#define BENCH_MAX_SIZE		(TRANSFER_SIZE * 4)
+#define BENCH_CHANNELS		2
+#define BENCH_LOOPS		8
+#define BENCH_TIMEOUT		K_MSEC(100)
+
+static const struct {
+	uint8_t size;
+	const char *name;
+} bench_widths[] = {
+	{ 1, "1B" },
+	{ 2, "1W" },
+	{ 4, "1DW" },
+	{ 16, "Burst" },
+};
+
+struct bench_stat {
+	uint64_t setup;		/* dma_config() */
+	uint64_t start;		/* dma_start() */
+	uint64_t complete;	/* dma_start() to completion callback */
+	uint32_t loops;
+};
+
+static uint8_t bench_src[BENCH_MAX_SIZE] __aligned(16);
+static uint8_t bench_dst[BENCH_MAX_SIZE] __aligned(16);
+static K_SEM_DEFINE(bench_done, 0, 1);
+static volatile uint32_t bench_cb_cycles;
+static volatile int bench_cb_status;
+
+static void cb_bench(const struct device *dma_dev, void *arg,
+				uint32_t channel, int status)
+{
+	bench_cb_cycles = test_timing_cycles();
+	bench_cb_status = status;
+	k_sem_give(&bench_done);
+}
+
+/* Run one timed transfer and add its cost to stat */
+static int dma_bench_xfer(const struct device *dma_dev, uint8_t channel,
+			  struct dma_config *cfg, struct bench_stat *stat)
+{
+	uint32_t t0, t1, t2;
+	int rc;
+
+	k_sem_reset(&bench_done);
+
+	t0 = test_timing_cycles();
+	rc = dma_config(dma_dev, channel, cfg);
+	t1 = test_timing_cycles();
+	if (rc) {
+		return rc;
+	}
+	rc = dma_start(dma_dev, channel);
+	t2 = test_timing_cycles();
+	if (rc) {
+		return rc;
+	}
+	if (k_sem_take(&bench_done, BENCH_TIMEOUT)) {
+		dma_stop(dma_dev, channel);
+		return -ETIMEDOUT;
+	}
+	if (bench_cb_status < 0) {
+		return bench_cb_status;
+	}
+
+	stat->setup += t1 - t0;
+	stat->start += t2 - t1;
+	stat->complete += bench_cb_cycles - t1;
+	stat->loops++;
+
+	return 0;
+}
+
+static int dma_bench_run(const struct device *dma_dev, uint8_t channel, uint8_t width,
+			 size_t size, struct bench_stat *stat)
+{
+	struct dma_config cfg = { 0 };
+	struct dma_block_config blk = { 0 };
+	struct test_pattern pat;
+	uint32_t err_addr;
+	int rc;
+
+	cfg.channel_direction = MEMORY_TO_MEMORY;
+	cfg.source_data_size = cfg.dest_data_size = width;
+	cfg.source_burst_length = cfg.dest_burst_length = width;
+	cfg.block_count = 1;
+	cfg.head_block = &blk;
+	cfg.dma_callback = cb_bench;
+	blk.source_address = (uint32_t)bench_src;
+	blk.dest_address = (uint32_t)bench_dst;
+	blk.block_size = size;
+
+	memset(stat, 0, sizeof(*stat));
+	for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+		memset(bench_dst, 0, size);
+		rc = dma_bench_xfer(dma_dev, channel, &cfg, stat);
+		if (rc) {
+			return rc;
+		}
+
+		/* Verify outside of the timed region */
+		test_pattern_init(&pat, TEST_PATTERN_ADDR, 0, 0);
+		if (test_pattern_verify(&pat, bench_dst, size, &err_addr)) {
+			LOG_ERR("%s ch%d: mismatch at offset 0x%x", dma_dev->name, channel,
+				err_addr);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static uint64_t dma_bench_memcpy(size_t size)
+{
+	uint32_t start;
+	uint64_t cycles = 0;
+
+	for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+		start = test_timing_cycles();
+		memcpy(bench_dst, bench_src, size);
+		cycles += test_timing_cycles() - start;
+	}
+
+	return cycles;
+}
+
+/* Print bytes per cycle with three decimals */
+static void dma_bench_bpc(char *buf, size_t len, uint64_t bytes, uint64_t cycles)
+{
+	uint32_t mbpc = (cycles == 0) ? 0 : (uint32_t)(bytes * 1000U / cycles);
+
+	snprintk(buf, len, "%u.%03u", mbpc / 1000U, mbpc % 1000U);
+}
+
+static int dma_bench(const struct shell *shell, const struct device *dma_dev,
+		     uint8_t channel, size_t max_size)
+{
+	struct bench_stat stat;
+	char dma_bpc[16], cpu_bpc[16];
+	uint32_t kbps;
+	int fails = 0;
+	int rc;
+
+	shell_print(shell, "%s ch%d", dma_dev->name, channel);
+	shell_print(shell, "  %6s | %-5s | %9s | %9s | %9s | %9s | %9s | %s",
+		    "size", "width", "setup", "start", "complete", "B/cyc", "memcpy",
+		    "MB/s");
+
+	for (size_t size = BENCH_MIN_SIZE; size <= max_size; size <<= 1) {
+		dma_bench_bpc(cpu_bpc, sizeof(cpu_bpc), (uint64_t)size * BENCH_LOOPS,
+			      dma_bench_memcpy(size));
+
+		for (int i = 0; i < ARRAY_SIZE(bench_widths); i++) {
+			rc = dma_bench_run(dma_dev, channel, bench_widths[i].size, size, &stat);
+			if (rc == -EIO || rc == -ETIMEDOUT) {
+				fails++;
+			}
+			if (rc) {
+				shell_print(shell, "  %6u | %-5s | n/a (%d)", size,
+					    bench_widths[i].name, rc);
+				continue;
+			}
+
+			dma_bench_bpc(dma_bpc, sizeof(dma_bpc), (uint64_t)size * stat.loops,
+				      stat.complete);
+			kbps = test_timing_kbps((uint64_t)size * stat.loops, stat.complete);
+			shell_print(shell, "  %6u | %-5s | %9u | %9u | %9u | %9s | %9s | %u.%03u",
+				    size, bench_widths[i].name,
+				    (uint32_t)(stat.setup / stat.loops),
+				    (uint32_t)(stat.start / stat.loops),
+				    (uint32_t)(stat.complete / stat.loops), dma_bpc, cpu_bpc,
+				    kbps / 1000U, kbps % 1000U);
+		}
+	}
+
+	return fails;
+}
+
+static int dma_bench_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	size_t max_size = BENCH_MAX_SIZE;
+	struct test_pattern pat;
+	char *eptr;
+	int fails = 0;
+
+	if (argc > 1) {
+		max_size = strtoul(argv[1], &eptr, 0);
+		if (*eptr != '\0') {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+			return -EINVAL;
+		}
+		if (max_size < BENCH_MIN_SIZE || max_size > BENCH_MAX_SIZE) {
+			shell_error(shell, "Size must be %d ~ %d", BENCH_MIN_SIZE,
+				    BENCH_MAX_SIZE);
+			return -EINVAL;
+		}
+	}
+
+	test_pattern_init(&pat, TEST_PATTERN_ADDR, 0, 0);
+	test_pattern_fill(&pat, bench_src, sizeof(bench_src));
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Latency in host cycles, per transfer averaged over %d runs",
+		    BENCH_LOOPS);
+#else
+	shell_print(shell, "Latency in cycles (%u Hz), per transfer averaged over %d runs",
+		    sys_clock_hw_cycles_per_sec(), BENCH_LOOPS);
+#endif
+	for (int i = 0; i < NUM_DMA_DEVICE; i++) {
+		for (uint8_t channel = 0; channel < BENCH_CHANNELS; channel++) {
+			fails += dma_bench(shell, dma_devices[i], channel, max_size);
+		}
+	}
+
+	if (fails) {
+		shell_info(shell, "[FAIL] DMA bench, %d transfers failed", fails);
+		return -EIO;
+	}
+	shell_info(shell, "[PASS] DMA bench succeeded!");
+
+	return 0;
+}
+
+/* Concurrent multi-channel stress */
+#define STRESS_MAX_CHANNELS	(2 * BENCH_CHANNELS)
+#define STRESS_RING_SIZE	4
+#define STRESS_MAX_SIZE		(TRANSFER_SIZE / 2)
+#define STRESS_DEF_SIZE		256
+#define STRESS_WIDTH		4
+#define STRESS_HIST_BINS	24
+#define STRESS_TIMEOUT		K_MSEC(1000)
+
+enum stress_desc_state {
+	STRESS_DESC_FREE,	/* not used by this run */
+	STRESS_DESC_READY,	/* filled by thread, waiting for the channel */
+	STRESS_DESC_BUSY,	/* owned by the controller */
+	STRESS_DESC_DONE,	/* completed, waiting to be verified */
+};
+
+struct stress_desc {
+	struct dma_block_config blk;
+	uint32_t seq;
+	uint32_t start;		/* cycles at dma_start() */
+	uint32_t latency;	/* dma_start() to completion callback */
+	int status;
+	atomic_t state;
+};
+
+/*
+ * One ring of descriptors per channel. The completion callback runs in ISR
+ * context on npcx, so it only retires the descriptor in flight; the stress
+ * thread verifies, refills and restarts the channel with the next ready one.
+ */
+struct stress_chan {
+	const struct device *dev;
+	uint8_t channel;
+	struct dma_config cfg;
+	struct stress_desc desc[STRESS_RING_SIZE];
+	uint8_t head;		/* descriptor in flight or next to start */
+	uint8_t tail;		/* next descriptor to verify, thread side */
+	bool idle;
+	uint32_t next_seq;
+	uint32_t expect_seq;
+	uint32_t remaining;	/* transfers still to queue, under stress_lock */
+	uint32_t completed;
+	uint32_t order_errs;
+	uint32_t data_errs;
+	uint32_t xfer_errs;
+	uint32_t starved;	/* completions with no ready descriptor behind */
+	uint32_t lat_min;
+	uint32_t lat_max;
+};
+
+static struct stress_chan stress_chans[STRESS_MAX_CHANNELS];
+static uint8_t stress_src[STRESS_MAX_CHANNELS][STRESS_RING_SIZE][STRESS_MAX_SIZE] __aligned(16);
+static uint8_t stress_dst[STRESS_MAX_CHANNELS][STRESS_RING_SIZE][STRESS_MAX_SIZE] __aligned(16);
+static uint32_t stress_hist[STRESS_HIST_BINS];	/* log2 of completion latency */
+static size_t stress_size;
+static struct k_spinlock stress_lock;
+static K_SEM_DEFINE(stress_sem, 0, K_SEM_MAX_LIMIT);
+
+/* Start the descriptor at head if the channel is idle, stress thread only */
+static void dma_stress_kick(struct stress_chan *sc)
+{
+	k_spinlock_key_t key = k_spin_lock(&stress_lock);
+	struct stress_desc *d = &sc->desc[sc->head];
+	int rc;
+
+	if (!sc->idle || atomic_get(&d->state) != STRESS_DESC_READY) {
+		k_spin_unlock(&stress_lock, key);
+		return;
+	}
+
+	sc->idle = false;
+	atomic_set(&d->state, STRESS_DESC_BUSY);
+	k_spin_unlock(&stress_lock, key);
+
+	/* No callback can arrive before dma_start(), the driver runs unlocked */
+	sc->cfg.head_block = &d->blk;
+	d->start = test_timing_cycles();
+	rc = dma_config(sc->dev, sc->channel, &sc->cfg);
+	if (rc == 0) {
+		rc = dma_start(sc->dev, sc->channel);
+	}
+	if (rc) {
+		key = k_spin_lock(&stress_lock);
+		d->status = rc;
+		d->latency = 0;
+		/* Counted as a transfer error, the next completion is still in order */
+		sc->expect_seq = d->seq + 1;
+		atomic_set(&d->state, STRESS_DESC_DONE);
+		sc->head = (sc->head + 1) % STRESS_RING_SIZE;
+		sc->idle = true;
+		k_spin_unlock(&stress_lock, key);
+		k_sem_give(&stress_sem);
+	}
+}
+
+static void dma_stress_complete(struct stress_chan *sc, int status)
+{
+	struct stress_desc *d = &sc->desc[sc->head];
+	uint32_t now = test_timing_cycles();
+	k_spinlock_key_t key = k_spin_lock(&stress_lock);
+	uint32_t seq;
+
+	d->latency = now - d->start;
+	d->status = status;
+
+	/* The sequence number leads each buffer, a stale or reordered completion shows here */
+	memcpy(&seq, (void *)d->blk.dest_address, sizeof(seq));
+	if (seq != sc->expect_seq || d->seq != sc->expect_seq) {
+		sc->order_errs++;
+	}
+	sc->expect_seq = d->seq + 1;
+
+	atomic_set(&d->state, STRESS_DESC_DONE);
+	sc->head = (sc->head + 1) % STRESS_RING_SIZE;
+	sc->idle = true;
+	if (sc->remaining && atomic_get(&sc->desc[sc->head].state) != STRESS_DESC_READY) {
+		sc->starved++;
+	}
+	k_spin_unlock(&stress_lock, key);
+
+	/* The stress thread restarts the channel, not the ISR */
+	k_sem_give(&stress_sem);
+}
+
+static void dma_stress_fill(struct stress_chan *sc, struct stress_desc *d)
+{
+	struct test_pattern pat;
+	uint8_t *src = (uint8_t *)d->blk.source_address;
+	k_spinlock_key_t key;
+
+	d->seq = sc->next_seq++;
+	test_pattern_init(&pat, TEST_PATTERN_ADDR, d->seq, 0);
+	test_pattern_fill(&pat, src, stress_size);
+	memcpy(src, &d->seq, sizeof(d->seq));
+	memset((void *)d->blk.dest_address, 0, stress_size);
+	d->status = 0;
+
+	key = k_spin_lock(&stress_lock);
+	sc->remaining--;
+	atomic_set(&d->state, STRESS_DESC_READY);
+	k_spin_unlock(&stress_lock, key);
+}
+
+/* Verify one completed descriptor, return false if there was none */
+static bool dma_stress_retire(struct stress_chan *sc)
+{
+	struct stress_desc *d = &sc->desc[sc->tail];
+	const uint8_t *dst = (const uint8_t *)d->blk.dest_address;
+	struct test_pattern pat;
+	uint32_t seq, err_addr;
+	int bin;
+
+	if (atomic_get(&d->state) != STRESS_DESC_DONE) {
+		return false;
+	}
+
+	if (d->status < 0) {
+		sc->xfer_errs++;
+	} else {
+		memcpy(&seq, dst, sizeof(seq));
+		test_pattern_init(&pat, TEST_PATTERN_ADDR, d->seq, sizeof(seq));
+		if (seq != d->seq ||
+		    test_pattern_verify(&pat, dst + sizeof(seq), stress_size - sizeof(seq),
+					&err_addr)) {
+			sc->data_errs++;
+		}
+
+		bin = (d->latency == 0) ? 0 : 32 - __builtin_clz(d->latency);
+		stress_hist[MIN(bin, STRESS_HIST_BINS - 1)]++;
+		sc->lat_min = MIN(sc->lat_min, d->latency);
+		sc->lat_max = MAX(sc->lat_max, d->latency);
+	}
+	sc->completed++;
+	sc->tail = (sc->tail + 1) % STRESS_RING_SIZE;
+
+	/* Only this thread decrements remaining, reading it unlocked is safe */
+	if (sc->remaining) {
+		dma_stress_fill(sc, d);
+	}
+	dma_stress_kick(sc);
+
+	return true;
+}
+
+static int dma_stress_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	struct stress_chan *sc;
+	uint32_t count, total, start, cycles, kbps;
+	uint32_t errs = 0, pending;
+	uint64_t bytes;
+	char bpc[16];
+	int num = 0;
+	char *eptr;
+
+	count = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+	stress_size = STRESS_DEF_SIZE;
+	if (argc > 2) {
+		stress_size = strtoul(argv[2], &eptr, 0);
+		if (*eptr != '\0') {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+			return -EINVAL;
+		}
+	}
+	if (count == 0 || stress_size < 16 || stress_size > STRESS_MAX_SIZE ||
+	    stress_size % STRESS_WIDTH) {
+		shell_error(shell, "Count must be > 0, size must be 16 ~ %d and DW aligned",
+			    STRESS_MAX_SIZE);
+		return -EINVAL;
+	}
+
+	memset(stress_chans, 0, sizeof(stress_chans));
+	memset(stress_hist, 0, sizeof(stress_hist));
+	k_sem_reset(&stress_sem);
+
+	for (int i = 0; i < NUM_DMA_DEVICE; i++) {
+		for (uint8_t channel = 0; channel < BENCH_CHANNELS; channel++, num++) {
+			sc = &stress_chans[num];
+			sc->dev = dma_devices[i];
+			sc->channel = channel;
+			sc->remaining = count;
+			sc->idle = true;
+			sc->lat_min = UINT32_MAX;
+			sc->cfg.channel_direction = MEMORY_TO_MEMORY;
+			sc->cfg.source_data_size = sc->cfg.dest_data_size = STRESS_WIDTH;
+			sc->cfg.source_burst_length = sc->cfg.dest_burst_length = STRESS_WIDTH;
+			sc->cfg.block_count = 1;
+			sc->cfg.dma_callback = cb_data_check;
+			sc->cfg.user_data = sc;
+			for (int j = 0; j < STRESS_RING_SIZE; j++) {
+				sc->desc[j].blk.source_address = (uint32_t)stress_src[num][j];
+				sc->desc[j].blk.dest_address = (uint32_t)stress_dst[num][j];
+				sc->desc[j].blk.block_size = stress_size;
+				if (sc->remaining) {
+					dma_stress_fill(sc, &sc->desc[j]);
+				}
+			}
+		}
+	}
+
+	shell_print(shell, "%d channels, %u transfers of %u bytes each, ring of %d",
+		    num, count, stress_size, STRESS_RING_SIZE);
+
+	start = test_timing_cycles();
+	for (int i = 0; i < num; i++) {
+		dma_stress_kick(&stress_chans[i]);
+	}
+
+	total = count * num;
+	pending = total;
+	while (pending) {
+		if (k_sem_take(&stress_sem, STRESS_TIMEOUT)) {
+			shell_error(shell, "Timeout, %u transfers not completed", pending);
+			for (int i = 0; i < num; i++) {
+				dma_stop(stress_chans[i].dev, stress_chans[i].channel);
+			}
+			errs += pending;
+			break;
+		}
+		for (int i = 0; i < num; i++) {
+			while (dma_stress_retire(&stress_chans[i])) {
+				pending--;
+			}
+		}
+	}
+	cycles = test_timing_cycles() - start;
+
+	shell_print(shell, "  %-12s | %8s | %8s | %8s | %8s | %8s | %9s | %9s",
+		    "channel", "done", "order", "data", "xfer", "starved", "min lat",
+		    "max lat");
+	for (int i = 0; i < num; i++) {
+		sc = &stress_chans[i];
+		errs += sc->order_errs + sc->data_errs + sc->xfer_errs;
+		shell_print(shell, "  %-8s ch%d | %8u | %8u | %8u | %8u | %8u | %9u | %9u",
+			    sc->dev->name, sc->channel, sc->completed, sc->order_errs,
+			    sc->data_errs, sc->xfer_errs, sc->starved,
+			    sc->lat_min == UINT32_MAX ? 0 : sc->lat_min, sc->lat_max);
+	}
+
+	shell_print(shell, "Completion latency histogram (cycles):");
+	for (int i = 0; i < STRESS_HIST_BINS; i++) {
+		if (stress_hist[i] == 0) {
+			continue;
+		}
+		if (i == STRESS_HIST_BINS - 1) {
+			shell_print(shell, "  >= 2^%-2d | %u", i - 1, stress_hist[i]);
+		} else {
+			shell_print(shell, "  <  2^%-2d | %u", i, stress_hist[i]);
+		}
+	}
+
+	bytes = (uint64_t)stress_size * (total - pending);
+	dma_bench_bpc(bpc, sizeof(bpc), bytes, cycles);
+	kbps = test_timing_kbps(bytes, cycles);
+	shell_print(shell, "Aggregate: %u bytes in %u cycles, %s B/cyc, %u.%03u MB/s",
+		    (uint32_t)bytes, cycles, bpc, kbps / 1000U, kbps % 1000U);
+
+	if (errs) {
+		shell_info(shell, "[FAIL] DMA stress, %u errors", errs);
+		return -EIO;
+	}
+	shell_info(shell, "[PASS] DMA stress succeeded!");
+
+	return 0;
+}
+
+/* Scatter-gather chains */
+#define SG_MAX_BLOCKS		16
+#define SG_GUARD		16
+#define SG_GUARD_BYTE		0xA5
+#define SG_WIDTH		4
+
+static struct dma_block_config sg_blocks[SG_MAX_BLOCKS];
+static uint32_t sg_offs[SG_MAX_BLOCKS];	/* offset of each block in the source */
+static uint8_t sg_dst[BENCH_MAX_SIZE + SG_MAX_BLOCKS * SG_GUARD] __aligned(16);
+static struct dma_config sg_cfg;
+static uint8_t sg_num;
+static bool sg_soft;
+
+/*
+ * With software chaining every block is its own transfer, which is what a
+ * driver without linked block support leaves us with. The callback runs in
+ * ISR context on npcx, so it only signals and the thread starts the next block.
+ */
+static int dma_sg_soft_xfer(const struct device *dma_dev, uint8_t channel,
+			    struct bench_stat *stat)
+{
+	uint32_t t0, t1, t2;
+	int rc;
+
+	k_sem_reset(&bench_done);
+
+	t0 = test_timing_cycles();
+	rc = dma_config(dma_dev, channel, &sg_cfg);
+	t1 = test_timing_cycles();
+	if (rc) {
+		return rc;
+	}
+	rc = dma_start(dma_dev, channel);
+	t2 = test_timing_cycles();
+	if (rc) {
+		return rc;
+	}
+
+	for (int i = 1; ; i++) {
+		if (k_sem_take(&bench_done, BENCH_TIMEOUT)) {
+			dma_stop(dma_dev, channel);
+			return -ETIMEDOUT;
+		}
+		if (bench_cb_status < 0) {
+			return bench_cb_status;
+		}
+		if (i == sg_num) {
+			break;
+		}
+
+		sg_cfg.head_block = &sg_blocks[i];
+		rc = dma_config(dma_dev, channel, &sg_cfg);
+		if (rc == 0) {
+			rc = dma_start(dma_dev, channel);
+		}
+		if (rc) {
+			return -EIO;
+		}
+	}
+
+	stat->setup += t1 - t0;
+	stat->start += t2 - t1;
+	stat->complete += bench_cb_cycles - t1;
+	stat->loops++;
+
+	return 0;
+}
+
+/* Each destination block is followed by a guard area that must stay untouched */
+static int dma_sg_verify(const struct device *dma_dev, uint8_t channel)
+{
+	struct test_pattern pat;
+	const uint8_t *dst;
+	uint32_t err_addr;
+
+	for (int i = 0; i < sg_num; i++) {
+		dst = (const uint8_t *)sg_blocks[i].dest_address;
+		test_pattern_init(&pat, TEST_PATTERN_ADDR, 0, sg_offs[i]);
+		if (test_pattern_verify(&pat, dst, sg_blocks[i].block_size, &err_addr)) {
+			LOG_ERR("%s ch%d: block %d mismatch at offset 0x%x", dma_dev->name,
+				channel, i, err_addr);
+			return -EIO;
+		}
+		for (int j = 0; j < SG_GUARD; j++) {
+			if (dst[sg_blocks[i].block_size + j] != SG_GUARD_BYTE) {
+				LOG_ERR("%s ch%d: block %d overran its destination",
+					dma_dev->name, channel, i);
+				return -EIO;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int dma_sg_run(const struct device *dma_dev, uint8_t channel, struct bench_stat *stat)
+{
+	int rc;
+
+	sg_cfg.channel_direction = MEMORY_TO_MEMORY;
+	sg_cfg.source_data_size = sg_cfg.dest_data_size = SG_WIDTH;
+	sg_cfg.source_burst_length = sg_cfg.dest_burst_length = SG_WIDTH;
+	sg_cfg.dma_callback = cb_bench;
+
+	memset(stat, 0, sizeof(*stat));
+	for (uint32_t i = 0; i < BENCH_LOOPS; i++) {
+		memset(sg_dst, SG_GUARD_BYTE, sizeof(sg_dst));
+		sg_cfg.block_count = sg_soft ? 1 : sg_num;
+		sg_cfg.head_block = &sg_blocks[0];
+
+		if (sg_soft) {
+			rc = dma_sg_soft_xfer(dma_dev, channel, stat);
+		} else {
+			rc = dma_bench_xfer(dma_dev, channel, &sg_cfg, stat);
+		}
+		if (rc) {
+			return rc;
+		}
+		rc = dma_sg_verify(dma_dev, channel);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+static int dma_sg(const struct shell *shell, const struct device *dma_dev, uint8_t channel,
+		  size_t total)
+{
+	struct bench_stat single, chain;
+	char bpc[16];
+	int32_t per_block;
+	int rc;
+
+	shell_print(shell, "%s ch%d", dma_dev->name, channel);
+	shell_print(shell, "  %-10s | %9s | %9s | %9s | %s", "mode", "setup", "complete",
+		    "B/cyc", "per block");
+
+	rc = dma_bench_run(dma_dev, channel, SG_WIDTH, total, &single);
+	if (rc) {
+		shell_print(shell, "  %-10s | n/a (%d)", "single", rc);
+		return rc;
+	}
+	dma_bench_bpc(bpc, sizeof(bpc), (uint64_t)total * single.loops, single.complete);
+	shell_print(shell, "  %-10s | %9u | %9u | %9s |", "single",
+		    (uint32_t)(single.setup / single.loops),
+		    (uint32_t)(single.complete / single.loops), bpc);
+
+	/* Fall back to chaining from the thread if the driver takes a single block only */
+	sg_soft = false;
+	rc = dma_sg_run(dma_dev, channel, &chain);
+	if (rc && rc != -EIO && rc != -ETIMEDOUT && sg_num > 1) {
+		sg_soft = true;
+		rc = dma_sg_run(dma_dev, channel, &chain);
+	}
+	if (rc) {
+		shell_print(shell, "  %-10s | n/a (%d)", "chain", rc);
+		return rc;
+	}
+
+	per_block = 0;
+	if (sg_num > 1) {
+		per_block = (int32_t)((chain.complete / chain.loops) -
+				      (single.complete / single.loops)) / (sg_num - 1);
+	}
+	dma_bench_bpc(bpc, sizeof(bpc), (uint64_t)total * chain.loops, chain.complete);
+	shell_print(shell, "  %-10s | %9u | %9u | %9s | %d", sg_soft ? "chain (sw)" : "chain (hw)",
+		    (uint32_t)(chain.setup / chain.loops),
+		    (uint32_t)(chain.complete / chain.loops), bpc, per_block);
+
+	return 0;
+}
+
+static int dma_sg_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	struct test_pattern pat;
+	uint32_t blocks, size, offs = 0;
+	char *eptr;
+	int fails = 0;
+
+	blocks = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+	if (blocks == 0 || blocks > SG_MAX_BLOCKS) {
+		shell_error(shell, "Block count must be 1 ~ %d", SG_MAX_BLOCKS);
+		return -EINVAL;
+	}
+
+	/* Block sizes are taken from the list in turn, repeating it as needed */
+	for (int i = 0; i < blocks; i++) {
+		const char *arg = argv[2 + i % (argc - 2)];
+
+		size = strtoul(arg, &eptr, 0);
+		if (*eptr != '\0') {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", arg);
+			return -EINVAL;
+		}
+		if (size == 0 || size % SG_WIDTH || offs + size > BENCH_MAX_SIZE) {
+			shell_error(shell, "Block sizes must be DW aligned, %d bytes at most in total",
+				    BENCH_MAX_SIZE);
+			return -EINVAL;
+		}
+
+		memset(&sg_blocks[i], 0, sizeof(sg_blocks[i]));
+		sg_blocks[i].source_address = (uint32_t)&bench_src[offs];
+		sg_blocks[i].dest_address = (uint32_t)&sg_dst[offs + i * SG_GUARD];
+		sg_blocks[i].block_size = size;
+		if (i > 0) {
+			sg_blocks[i - 1].next_block = &sg_blocks[i];
+		}
+		sg_offs[i] = offs;
+		offs += size;
+	}
+	sg_num = blocks;
+
+	test_pattern_init(&pat, TEST_PATTERN_ADDR, 0, 0);
+	test_pattern_fill(&pat, bench_src, sizeof(bench_src));
+
+	shell_print(shell, "%u blocks, %u bytes, cycles averaged over %d runs", blocks, offs,
+		    BENCH_LOOPS);
+	for (int i = 0; i < NUM_DMA_DEVICE; i++) {
+		for (uint8_t channel = 0; channel < BENCH_CHANNELS; channel++) {
+			if (dma_sg(shell, dma_devices[i], channel, offs)) {
+				fails++;
+			}
+		}
+	}
+
+	if (fails) {
+		shell_info(shell, "[FAIL] DMA sg, %d channels failed", fails);
+		return -EIO;
+	}
+	shell_info(shell, "[PASS] DMA sg succeeded!");
+
+	return 0;
+}
+
 static void dma_validation_func(void *dummy1, void *dummy2, void *dummy3)
 {
 	uint32_t events;
@@ -659,24 +1454,36 @@ void test_dma_init(void)
 SHELL_STATIC_SUBCMD_SET_CREATE(
 	sub_dma, SHELL_CMD_ARG(ex, NULL, "dma ex: dma api test",
 		dma_api_example, 1, 0),
+	#ifdef CONFIG_SOC_FAMILY_NPCX
 	SHELL_CMD_ARG(gpd, NULL, "dma gpd: dma power down test",
 		npcx_power_down_2, 1, 0),
 	SHELL_CMD_ARG(gps, NULL, "dma gps: dma power save test",
 		npcx_power_save, 1, 0),
+	#endif
 	SHELL_CMD_ARG(sync, NULL, "dma sync <1~6>",
 		sync_data_transfer, 2, 0),
 	SHELL_CMD_ARG(c3, NULL, "dma c3 init <dev> <channel>: choose dev and channel",
 		dma_command, 4, 0),
+	#ifdef CONFIG_SOC_FAMILY_NPCX
 	SHELL_CMD_ARG(def, NULL, "dma def: check default value of register",
 		check_def_value, 1, 0),
+	#endif
 	#ifdef CONFIG_SOC_SERIES_NPCK3
 	SHELL_CMD_ARG(err, NULL, "dma err: gdmaerr test",
 		dma_gdmaerr, 1, 0),
 	#endif
+	#ifdef CONFIG_SOC_FAMILY_NPCX
 	SHELL_CMD_ARG(ram, NULL, "dma ram <0/1> <1B/1W/1DW/Burst>",
 		dam_ram_to_ram, 3, 0),
 	SHELL_CMD_ARG(flash, NULL, "dma flash <int/ext/bkp flash> <GDMAMemPool/code ram>"
 		"<1B/1W/1DW/Burst>", dam_flash_to_ram, 4, 0),
+	#endif
+	SHELL_CMD_ARG(bench, NULL, "dma bench [max size]: throughput and latency sweep",
+		dma_bench_handler, 1, 1),
+	SHELL_CMD_ARG(stress, NULL, "dma stress <count> [size]: all channels concurrently",
+		dma_stress_handler, 2, 1),
+	SHELL_CMD_ARG(sg, NULL, "dma sg <blocks> <size> [size ...]: chained blocks vs one block",
+		dma_sg_handler, 3, SG_MAX_BLOCKS - 1),
 	SHELL_SUBCMD_SET_END /* Array terminated. */
 );
 SHELL_CMD_REGISTER(dma, &sub_dma, "nuvoton dma validation", NULL);
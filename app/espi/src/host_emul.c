@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/espi_emul.h>
+#include "host_emul.h"
+#include "host_trace.h"
+
+#define HOST_FLASH_SIZE		KB(CONFIG_ESPI_HOST_EMUL_FLASH_SIZE_KB)
+#define HOST_OOB_SIZE		80
+#define HOST_OOB_DEPTH		4
+#define HOST_HCMD_SIZE		256
+
+static uint8_t host_flash[HOST_FLASH_SIZE];
+static bool host_flash_ready;
+struct host_oob_pckt {
+	uint8_t buf[HOST_OOB_SIZE];
+	uint16_t len;
+};
+
+static struct host_oob_pckt host_oob[HOST_OOB_DEPTH];
+static uint32_t host_oob_head;
+static uint32_t host_oob_tail;
+static uint8_t host_hcmd_win[HOST_HCMD_SIZE] __aligned(4);
+static uint32_t host_hcmd_result;
+static const struct emul *const host_emul = EMUL_DT_GET(DT_NODELABEL(espi_host));
+
+static int host_emul_flash_check(uint32_t addr, uint32_t len)
+{
+	if (!host_flash_ready) {
+		memset(host_flash, 0xFF, sizeof(host_flash));
+		host_flash_ready = true;
+	}
+
+	if (addr >= HOST_FLASH_SIZE || len > HOST_FLASH_SIZE - addr) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int host_emul_flash_read(struct espi_flash_packet *pckt)
+{
+	int ret = host_emul_flash_check(pckt->flash_addr, pckt->len);
+
+	if (ret) {
+		return ret;
+	}
+
+	memcpy(pckt->buf, &host_flash[pckt->flash_addr], pckt->len);
+
+	return 0;
+}
+
+int host_emul_flash_write(struct espi_flash_packet *pckt)
+{
+	int ret = host_emul_flash_check(pckt->flash_addr, pckt->len);
+
+	if (ret) {
+		return ret;
+	}
+
+	for (uint32_t i = 0; i < pckt->len; i++) {
+		host_flash[pckt->flash_addr + i] &= pckt->buf[i];
+	}
+
+	return 0;
+}
+
+/* len carries the MAF erase size code */
+int host_emul_flash_erase(struct espi_flash_packet *pckt)
+{
+	uint32_t size;
+	int ret;
+
+	switch (pckt->len) {
+	case 1:
+		size = KB(4);
+		break;
+	case 2:
+		size = KB(64);
+		break;
+	case 4:
+		size = KB(128);
+		break;
+	case 5:
+		size = KB(256);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	ret = host_emul_flash_check(ROUND_DOWN(pckt->flash_addr, size), size);
+	if (ret) {
+		return ret;
+	}
+
+	memset(&host_flash[ROUND_DOWN(pckt->flash_addr, size)], 0xFF, size);
+
+	return 0;
+}
+
+int host_emul_vw_reply(enum espi_vwire_signal signal, uint8_t level)
+{
+	return emul_espi_host_set_vw(host_emul, signal, level);
+}
+
+int host_emul_oob_send(struct espi_oob_packet *pckt)
+{
+	struct host_oob_pckt *echo;
+
+	if (pckt->len > HOST_OOB_SIZE || pckt->len < 4) {
+		return -EINVAL;
+	}
+	if (host_oob_head - host_oob_tail >= HOST_OOB_DEPTH) {
+		return -EBUSY;
+	}
+
+	echo = &host_oob[host_oob_head % HOST_OOB_DEPTH];
+	memcpy(echo->buf, pckt->buf, pckt->len);
+	/* Reply goes from the destination back to the source */
+	echo->buf[0] = pckt->buf[3];
+	echo->buf[3] = pckt->buf[0];
+	echo->len = pckt->len;
+	host_oob_head++;
+
+	return 0;
+}
+
+int host_emul_oob_receive(struct espi_oob_packet *pckt)
+{
+	struct host_oob_pckt *echo;
+
+	if (host_oob_head == host_oob_tail) {
+		return -ETIMEDOUT;
+	}
+
+	echo = &host_oob[host_oob_tail % HOST_OOB_DEPTH];
+	if (echo->len > pckt->len) {
+		return -EINVAL;
+	}
+	memcpy(pckt->buf, echo->buf, echo->len);
+	pckt->len = echo->len;
+	host_oob_tail++;
+
+	return 0;
+}
+
+int host_emul_lpc_request(enum lpc_peripheral_opcode op, uint32_t *data)
+{
+	struct espi_event kbc_obe = {
+		.evt_type = ESPI_BUS_PERIPHERAL_NOTIFICATION,
+		.evt_details = ESPI_PERIPHERAL_8042_KBC,
+		.evt_data = HOST_KBC_EVT_OBE << 16,
+	};
+
+	switch (op) {
+	case ECUSTOM_HOST_CMD_GET_PARAM_MEMORY:
+		*data = (uint32_t)(uintptr_t)host_hcmd_win;
+		return 0;
+	case ECUSTOM_HOST_CMD_GET_PARAM_MEMORY_SIZE:
+		*data = sizeof(host_hcmd_win);
+		return 0;
+	case ECUSTOM_HOST_CMD_SEND_RESULT:
+		host_hcmd_result = *data;
+		return 0;
+	case E8042_WRITE_KB_CHAR:
+		host_trace_event(kbc_obe);
+		return 0;
+	case EACPI_WRITE_CHAR:
+		return 0;
+	case E8042_OBF_HAS_CHAR:
+	case EACPI_OBF_HAS_CHAR:
+		*data = 0;
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+}
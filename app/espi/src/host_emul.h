@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __HOST_EMUL_H__
+#define __HOST_EMUL_H__
+
+#include <zephyr/drivers/espi.h>
+
+/*
+ * Host stand-in for native_sim. Zephyr's espi_emul has no flash channel, so
+ * flash requests are served from a RAM backed host flash which behaves like
+ * NOR: erased to 0xFF, programming only clears bits.
+ */
+int host_emul_flash_read(struct espi_flash_packet *pckt);
+int host_emul_flash_write(struct espi_flash_packet *pckt);
+int host_emul_flash_erase(struct espi_flash_packet *pckt);
+
+/* Host side of a VW round trip, drive signal to level through espi_emul */
+int host_emul_vw_reply(enum espi_vwire_signal signal, uint8_t level);
+
+/*
+ * OOB loopback, espi_emul has no OOB channel either. Every packet sent is
+ * echoed back with the SMBus addresses swapped, in order, up to a small depth.
+ */
+int host_emul_oob_send(struct espi_oob_packet *pckt);
+int host_emul_oob_receive(struct espi_oob_packet *pckt);
+
+/*
+ * LPC requests espi_emul does not serve: the host command parameter window
+ * and result port, and 8042/ACPI output. The host reads every output byte
+ * straight away, for 8042 it raises HOST_KBC_EVT_OBE through host_trace.
+ */
+int host_emul_lpc_request(enum lpc_peripheral_opcode op, uint32_t *data);
+
+#endif /* __HOST_EMUL_H__ */
@@ -11,6 +11,17 @@
 #include <zephyr/shell/shell_uart.h>
 #include <stdlib.h>
 #include <zephyr/drivers/espi.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "espi_trace.h"
+#include "host_trace.h"
+#include "test_hist.h"
+#include "test_pattern.h"
+#include "test_timing.h"
+#ifdef CONFIG_ESPI_EMUL
+#include "host_emul.h"
+#endif
 
 #define LOG_LEVEL LOG_LEVEL_INF
 #include <zephyr/logging/log.h>
@@ -59,6 +70,12 @@ void espi_hcmd(uint32_t offs);
 int espi_maf_read(uint32_t start_addr);
 int espi_maf_write(uint32_t start_addr);
 int espi_maf_erase(uint32_t start_addr);
+int espi_fbench(const struct shell *shell, size_t argc, char **argv);
+int espi_p80_drain(const struct shell *shell, size_t argc, char **argv);
+int espi_vw_latency(const struct shell *shell, size_t argc, char **argv);
+int espi_oob_bulk(const struct shell *shell, size_t argc, char **argv);
+int espi_hcmd_bench(const struct shell *shell, size_t argc, char **argv);
+int espi_kb_stream(const struct shell *shell, size_t argc, char **argv);
 
 static void espi_validation_func(void *dummy1, void *dummy2, void *dummy3)
 {
@@ -209,6 +226,18 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_espi,
 	SHELL_CMD_ARG(c1, NULL, "espi c1 arg0", espi_command, 2, 0),
 	SHELL_CMD_ARG(c2, NULL, "espi c2 arg0 arg1", espi_command, 3, 0),
 	SHELL_CMD_ARG(cfg, NULL, "espi cfg arg0 arg1 arg2", espi_command, 4, 0),
+	SHELL_CMD_ARG(fbench, NULL, "espi fbench <addr> <size> [rw]: flash channel bench",
+		espi_fbench, 3, 1),
+	SHELL_CMD_ARG(p80, NULL, "espi p80 [lines]: drain captured postcodes",
+		espi_p80_drain, 1, 1),
+	SHELL_CMD_ARG(vwlat, NULL, "espi vwlat <vw_out index> <reply signal> [count] [poll]: "
+		"VW round trip latency", espi_vw_latency, 3, 2),
+	SHELL_CMD_ARG(oob, NULL, "espi oob <count> [len]: OOB bulk loopback throughput",
+		espi_oob_bulk, 2, 1),
+	SHELL_CMD_ARG(hcbench, NULL, "espi hcbench <count> [len]: host command window bench",
+		espi_hcmd_bench, 2, 1),
+	SHELL_CMD_ARG(kbstream, NULL, "espi kbstream <kbc/acpi> <count>: output byte stream",
+		espi_kb_stream, 3, 0),
 	SHELL_SUBCMD_SET_END /* Array terminated. */
 );
 SHELL_CMD_REGISTER(espi, &sub_espi, "eSPI validation commands", NULL);
@@ -295,6 +324,59 @@ static struct espi_callback p80_cb;
 static struct espi_callback oob_cb;
 static uint8_t espi_rst_sts;
 
+/*
+ * Port 80 capture ring. periph_handler is the only producer and "espi p80"
+ * the only consumer, head and tail are free running counters.
+ */
+#define P80_RING_SIZE		1024
+#define P80_BURST_CODES		16
+
+BUILD_ASSERT((P80_RING_SIZE & (P80_RING_SIZE - 1)) == 0, "P80_RING_SIZE not a power of 2");
+
+struct p80_rec {
+	uint32_t cycles;
+	uint32_t code;
+};
+
+static struct p80_rec p80_ring[P80_RING_SIZE];
+static atomic_t p80_head;
+static atomic_t p80_tail;
+static atomic_t p80_dropped;
+
+static void p80_ring_put(uint32_t code)
+{
+	uint32_t head = atomic_get(&p80_head);
+	struct p80_rec *rec;
+
+	if (head - (uint32_t)atomic_get(&p80_tail) >= P80_RING_SIZE) {
+		atomic_inc(&p80_dropped);
+		return;
+	}
+
+	rec = &p80_ring[head % P80_RING_SIZE];
+	rec->cycles = test_timing_cycles();
+	rec->code = code;
+	atomic_set(&p80_head, head + 1);
+}
+
+/* VW round trip, the reply the latency engine waits for */
+#define VWLAT_NONE		UINT32_MAX
+
+static K_SEM_DEFINE(vwlat_sem, 0, 1);
+static atomic_t vwlat_signal = ATOMIC_INIT(VWLAT_NONE);
+static uint32_t vwlat_level;
+static uint32_t vwlat_cycles;
+
+/* 8042 stream, OBE notifications pace the writes while it runs */
+static K_SEM_DEFINE(kbc_obe_sem, 0, 1);
+static atomic_t kbc_streaming;
+
+/* Callbacks the scripted host delivers its events to */
+static struct espi_callback *const host_trace_cbs[] = {
+	&vw_cb,
+	&p80_cb,
+};
+
 /* eSPI bus event handler */
 static void espi_reset_handler(const struct device *dev,
 					struct espi_callback *cb,
@@ -302,7 +384,7 @@ static void espi_reset_handler(const struct device *dev,
 {
 	if (event.evt_type == ESPI_BUS_RESET) {
 		espi_rst_sts = event.evt_data;
-		LOG_INF("eSPI BUS reset %d", event.evt_data);
+		espi_trace_event(event);
 	}
 }
 /* eSPI logical channels enable/disable event handler */
@@ -311,19 +393,7 @@ static void espi_ch_handler(const struct device *dev,
 				struct espi_event event)
 {
 	if (event.evt_type == ESPI_BUS_EVENT_CHANNEL_READY) {
-		switch (event.evt_details) {
-		case ESPI_CHANNEL_VWIRE:
-			LOG_INF("VW channel event %x", event.evt_data);
-			break;
-		case ESPI_CHANNEL_FLASH:
-			LOG_INF("Flash channel event %d", event.evt_data);
-			break;
-		case ESPI_CHANNEL_OOB:
-			LOG_INF("OOB channel event %d", event.evt_data);
-			break;
-		default:
-			LOG_ERR("Unknown channel event");
-		}
+		espi_trace_event(event);
 	}
 }
 
@@ -331,23 +401,15 @@ static void vwire_handler(const struct device *dev, struct espi_callback *cb,
 			  struct espi_event event)
 {
 	if (event.evt_type == ESPI_BUS_EVENT_VWIRE_RECEIVED) {
-		switch (event.evt_details) {
-		case ESPI_VWIRE_SIGNAL_PLTRST:
-			LOG_INF("PLT_RST:%d", event.evt_data);
-			break;
-		case ESPI_VWIRE_SIGNAL_SLP_S3:
-			LOG_INF("S3:%d", event.evt_data);
-			break;
-		case ESPI_VWIRE_SIGNAL_SLP_S4:
-			LOG_INF("S4:%d", event.evt_data);
-			break;
-		case ESPI_VWIRE_SIGNAL_SLP_S5:
-			LOG_INF("S5:%d", event.evt_data);
-			break;
-		case ESPI_VWIRE_SIGNAL_SLP_A:
-			LOG_INF("SLP_A:%d", event.evt_data);
-			break;
+		/* Time stamp the awaited reply before anything else */
+		if (event.evt_details == (uint32_t)atomic_get(&vwlat_signal) &&
+		    event.evt_data == vwlat_level) {
+			vwlat_cycles = test_timing_cycles();
+			atomic_set(&vwlat_signal, VWLAT_NONE);
+			k_sem_give(&vwlat_sem);
 		}
+
+		espi_trace_event(event);
 	}
 }
 
@@ -363,33 +425,141 @@ static void periph_handler(const struct device *dev, struct espi_callback *cb,
 
 	switch (periph_type) {
 	case ESPI_PERIPHERAL_DEBUG_PORT80:
+		/* Codes come in bursts, they have their own ring */
 		p80_sum += (unsigned int)event.evt_data;
-		break;
-	case ESPI_PERIPHERAL_HOST_IO:
-		LOG_INF("ACPI:%02x from %s", (unsigned char)(event.evt_data>>8),
-					(event.evt_data&0x1) ? "COMMAND" : "DBBIN");
+		p80_ring_put(event.evt_data);
 		break;
 	case ESPI_PERIPHERAL_8042_KBC:
-		if (event.evt_data & 0x20000)
-			LOG_INF("Got HOST_KBC_EVT_OBE evt");
-		if (event.evt_data & 0x10000) {
-			LOG_INF("Got HOST_KBC_EVT_IBF evt");
-			LOG_INF("KBC:%02x from %s", (unsigned char)(event.evt_data>>8),
-					(event.evt_data&0x1) ? "COMMAND" : "DBBIN");
+		/* KBC events sit in the upper half of evt_data, the data byte below */
+		if ((event.evt_data & (HOST_KBC_EVT_OBE << 16)) && atomic_get(&kbc_streaming)) {
+			/* One per streamed byte, it would only flood the trace ring */
+			k_sem_give(&kbc_obe_sem);
+			break;
 		}
-		break;
-	case ESPI_PERIPHERAL_EC_HOST_CMD:
-		LOG_INF("HC %x", event.evt_data);
+		espi_trace_event(event);
 		break;
 	default:
-		LOG_INF("%s periph 0x%x [%x]", __func__, periph_type,
-			event.evt_data);
+		espi_trace_event(event);
+	}
+}
+/* LPC requests, falling back to the host stand-in for what espi_emul lacks */
+static int espi_lpc_read(enum lpc_peripheral_opcode op, uint32_t *data)
+{
+	int ret = espi_read_lpc_request(espi_dev, op, data);
+
+#ifdef CONFIG_ESPI_EMUL
+	if (ret) {
+		ret = host_emul_lpc_request(op, data);
+	}
+#endif
+	return ret;
+}
+
+static int espi_lpc_write(enum lpc_peripheral_opcode op, uint32_t *data)
+{
+	int ret = espi_write_lpc_request(espi_dev, op, data);
+
+#ifdef CONFIG_ESPI_EMUL
+	if (ret) {
+		ret = host_emul_lpc_request(op, data);
+	}
+#endif
+	return ret;
+}
+
+/*
+ * OOB receive buffers come from a preallocated pool, never the stack, and
+ * are bounded by their size. With CONFIG_ESPI_OOB_CHANNEL_RX_ASYNC packets
+ * are received in the callback and posted to oob_rx_q, otherwise the
+ * consumer receives into a pool buffer itself.
+ */
+#define OOB_HDR_SIZE		4
+#define OOB_MAX_PAYLOAD		64
+#define OOB_POOL_NUM		4
+#define OOB_TIMEOUT_MS		100
+#define OOB_DEST_ADDR		0x02
+#define OOB_CMD_CODE		0x01
+#define OOB_SRC_ADDR		0x21
+
+struct oob_rx {
+	uint32_t cycles;
+	uint16_t len;
+	uint8_t buf[OOB_HDR_SIZE + OOB_MAX_PAYLOAD];
+};
+
+K_MEM_SLAB_DEFINE_STATIC(oob_slab, sizeof(struct oob_rx), OOB_POOL_NUM, 4);
+K_MSGQ_DEFINE(oob_rx_q, sizeof(struct oob_rx *), OOB_POOL_NUM, 4);
+static atomic_t oob_rx_dropped;
+
+static int oob_send(struct espi_oob_packet *pckt)
+{
+	int ret = espi_send_oob(espi_dev, pckt);
+
+#ifdef CONFIG_ESPI_EMUL
+	if (ret == -ENOTSUP) {
+		ret = host_emul_oob_send(pckt);
+	}
+#endif
+	return ret;
+}
+
+static int oob_receive(struct oob_rx *rx)
+{
+	struct espi_oob_packet pckt = {
+		.buf = rx->buf,
+		.len = sizeof(rx->buf),
+	};
+	int ret = espi_receive_oob(espi_dev, &pckt);
+
+#ifdef CONFIG_ESPI_EMUL
+	if (ret == -ENOTSUP) {
+		ret = host_emul_oob_receive(&pckt);
+	}
+#endif
+	rx->cycles = test_timing_cycles();
+	rx->len = pckt.len;
+
+	return ret;
+}
+
+/* Take the next received packet, free it with k_mem_slab_free() */
+static int oob_rx_get(struct oob_rx **rx)
+{
+#ifdef CONFIG_ESPI_OOB_CHANNEL_RX_ASYNC
+	return k_msgq_get(&oob_rx_q, rx, K_MSEC(OOB_TIMEOUT_MS));
+#else
+	int ret = k_mem_slab_alloc(&oob_slab, (void **)rx, K_NO_WAIT);
+
+	if (ret) {
+		return ret;
+	}
+	ret = oob_receive(*rx);
+	if (ret) {
+		k_mem_slab_free(&oob_slab, *rx);
 	}
+
+	return ret;
+#endif
 }
+
 static void oob_handler(const struct device *dev, struct espi_callback *cb,
 			   struct espi_event event)
 {
-	LOG_INF("Got OOB evt");
+#ifdef CONFIG_ESPI_OOB_CHANNEL_RX_ASYNC
+	struct oob_rx *rx;
+#endif
+
+	espi_trace_event(event);
+#ifdef CONFIG_ESPI_OOB_CHANNEL_RX_ASYNC
+	if (k_mem_slab_alloc(&oob_slab, (void **)&rx, K_NO_WAIT)) {
+		atomic_inc(&oob_rx_dropped);
+		return;
+	}
+	if (oob_receive(rx) || k_msgq_put(&oob_rx_q, &rx, K_NO_WAIT)) {
+		atomic_inc(&oob_rx_dropped);
+		k_mem_slab_free(&oob_slab, rx);
+	}
+#endif
 }
 void espi_init(void)
 {
@@ -408,6 +578,7 @@ void espi_init(void)
 	espi_add_callback(espi_dev, &vw_cb);
 	espi_add_callback(espi_dev, &p80_cb);
 	espi_add_callback(espi_dev, &oob_cb);
+	host_trace_init(espi_dev, host_trace_cbs, ARRAY_SIZE(host_trace_cbs));
 	LOG_INF("initial complete");
 	espi_write_lpc_request(espi_dev, ECUSTOM_HOST_SUBS_INTERRUPT_EN, &enable);
 }
@@ -415,18 +586,19 @@ void espi_init(void)
 void espi_oob_txrx(uint8_t txrx)
 {
 	struct espi_oob_packet pckt;
+	struct oob_rx *rx;
 	uint8_t buff[20], i;
 
 	if (txrx == 0) {
-		pckt.buf = buff;
-		if (espi_receive_oob(espi_dev, &pckt) == 0)
-			LOG_INF("[PASS] len:%d", pckt.len);
+		if (oob_rx_get(&rx) == 0)
+			LOG_INF("[PASS] len:%d", rx->len);
 		else {
 			LOG_INF("[FAIL]");
 			return;
 		}
-		for (i = 0; i < pckt.len; i++)
-			LOG_INF("[%02x]", pckt.buf[i]);
+		for (i = 0; i < rx->len; i++)
+			LOG_INF("[%02x]", rx->buf[i]);
+		k_mem_slab_free(&oob_slab, rx);
 	} else {
 		pckt.len = 5;
 		pckt.buf = buff;
@@ -464,8 +636,9 @@ ESPI_VWIRE_SIGNAL_SMI
 };
 void espi_send_vw(char vw, char level)
 {
-	if (vw >= sizeof(vw_out)/sizeof(unsigned char)) {
+	if (vw >= ARRAY_SIZE(vw_out)) {
 		LOG_INF("Out range [FAIL]");
+		return;
 	}
 	level = (char)espi_send_vwire(espi_dev, (enum espi_vwire_signal)vw_out[(int)vw], level);
 	LOG_INF("send [%s]", (level) ? "FAIL" : "PASS");
@@ -525,16 +698,19 @@ int write_test_block(uint8_t *buf, uint32_t start_flash_adr, uint16_t len)
 {
 	int ret = 0;
 	struct espi_flash_packet pckt;
+	uint16_t offs;
 
-	/* Split operation in multiple MAX_FLASH_REQ transactions */
-	pckt.buf = buf;
-	pckt.flash_addr = start_flash_adr;
-	pckt.len = len;
+	/* Split operation in multiple MAX_FLASH_WRITE_REQUEST transactions */
+	for (offs = 0; offs < len; offs += pckt.len) {
+		pckt.buf = buf + offs;
+		pckt.flash_addr = start_flash_adr + offs;
+		pckt.len = MIN(len - offs, MAX_FLASH_WRITE_REQUEST);
 
-	ret = espi_write_flash(espi_dev, &pckt);
-	if (ret) {
-		LOG_ERR("espi_write_flash failed: %d", ret);
-		return ret;
+		ret = espi_write_flash(espi_dev, &pckt);
+		if (ret) {
+			LOG_ERR("espi_write_flash failed: %d", ret);
+			return ret;
+		}
 	}
 
 	LOG_INF("write flash transactions (total=%d Bytes) completed", len);
@@ -619,3 +795,861 @@ int espi_maf_erase(uint32_t start_addr)
 
 	return 0;
 }
+
+/* Flash channel throughput benchmark */
+#define FBENCH_MIN_PAYLOAD	8
+#define FBENCH_ERASE_SIZE	KB(4)
+
+enum fbench_op {
+	FBENCH_READ,
+	FBENCH_WRITE,
+	FBENCH_ERASE,
+};
+
+static struct test_hist fbench_lat;
+
+static int fbench_flash(enum fbench_op op, struct espi_flash_packet *pckt)
+{
+	int ret;
+
+	switch (op) {
+	case FBENCH_READ:
+		ret = espi_read_flash(espi_dev, pckt);
+		break;
+	case FBENCH_WRITE:
+		ret = espi_write_flash(espi_dev, pckt);
+		break;
+	default:
+		ret = espi_flash_erase(espi_dev, pckt);
+		break;
+	}
+
+#ifdef CONFIG_ESPI_EMUL
+	/* espi_emul has no flash channel, the host stand-in serves it */
+	if (ret == -ENOTSUP) {
+		switch (op) {
+		case FBENCH_READ:
+			ret = host_emul_flash_read(pckt);
+			break;
+		case FBENCH_WRITE:
+			ret = host_emul_flash_write(pckt);
+			break;
+		default:
+			ret = host_emul_flash_erase(pckt);
+			break;
+		}
+	}
+#endif
+
+	return ret;
+}
+
+/*
+ * Move size bytes at addr in payload sized transactions. Writes program the
+ * address pattern, reads verify it when verify is set and always update crc.
+ */
+static int fbench_pass(enum fbench_op op, uint32_t addr, uint32_t size, uint32_t payload,
+		       bool verify, uint64_t *cycles, uint32_t *crc, uint32_t *errs)
+{
+	struct espi_flash_packet pckt;
+	struct test_pattern pat;
+	uint32_t len, start, lat, err_addr;
+	int ret;
+
+	test_pattern_init(&pat, TEST_PATTERN_ADDR, 0, addr);
+	test_hist_reset(&fbench_lat);
+	*cycles = 0;
+
+	for (uint32_t offs = 0; offs < size; offs += len) {
+		len = MIN(payload, size - offs);
+		pckt.flash_addr = addr + offs;
+		pckt.len = len;
+		if (op == FBENCH_WRITE) {
+			pckt.buf = flash_write_buf;
+			test_pattern_fill(&pat, flash_write_buf, len);
+		} else {
+			pckt.buf = flash_read_buf;
+		}
+
+		start = test_timing_cycles();
+		ret = fbench_flash(op, &pckt);
+		lat = test_timing_cycles() - start;
+		if (ret) {
+			LOG_ERR("Flash %s at 0x%x failed: %d", (op == FBENCH_WRITE) ?
+				"write" : "read", pckt.flash_addr, ret);
+			return ret;
+		}
+		test_hist_add(&fbench_lat, lat);
+		*cycles += lat;
+
+		if (op == FBENCH_READ) {
+			*crc = crc32_ieee_update(*crc, flash_read_buf, len);
+			if (verify) {
+				*errs += test_pattern_verify(&pat, flash_read_buf, len, &err_addr);
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int fbench_erase(uint32_t addr, uint32_t size)
+{
+	struct espi_flash_packet pckt;
+	int ret;
+
+	for (uint32_t offs = 0; offs < size; offs += FBENCH_ERASE_SIZE) {
+		pckt.flash_addr = addr + offs;
+		pckt.len = MAF_ERASE_4K;
+		ret = fbench_flash(FBENCH_ERASE, &pckt);
+		if (ret) {
+			LOG_ERR("Flash erase at 0x%x failed: %d", pckt.flash_addr, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void fbench_print(const struct shell *shell, uint32_t payload, const char *op,
+			 uint32_t size, uint64_t cycles)
+{
+	uint32_t count = test_hist_count(&fbench_lat);
+	uint32_t kbps = test_timing_kbps(size, cycles);
+
+	shell_print(shell, "  %7u | %-5s | %9u | %9u | %9u | %9u | %u.%03u", payload, op,
+		    (uint32_t)(cycles / MAX(count, 1)), test_hist_percentile(&fbench_lat, 99),
+		    test_hist_max(&fbench_lat), (uint32_t)(cycles * 1024U / size),
+		    kbps / 1000U, kbps % 1000U);
+}
+
+int espi_fbench(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t addr, size, crc, ref_crc = 0, errs = 0;
+	bool rw = false;
+	uint64_t cycles;
+	char *eptr;
+	int ret;
+
+	addr = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+	size = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+	if (argc > 3) {
+		if (strcmp(argv[3], "rw") != 0) {
+			shell_error(shell, "Invalid argument, '%s'", argv[3]);
+			return -EINVAL;
+		}
+		rw = true;
+	}
+	if (size == 0 || (rw && (addr % FBENCH_ERASE_SIZE || size % FBENCH_ERASE_SIZE))) {
+		shell_error(shell, "Size must be > 0, 4 KB aligned with address for rw");
+		return -EINVAL;
+	}
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Transaction latency in host cycles");
+#else
+	shell_print(shell, "Transaction latency in cycles (%u Hz)",
+		    sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "  %7s | %-5s | %9s | %9s | %9s | %9s | %s", "payload", "op", "avg",
+		    "p99", "max", "cyc/KB", "MB/s");
+
+	for (uint32_t payload = FBENCH_MIN_PAYLOAD; payload <= MAX_FLASH_REQUEST;
+	     payload <<= 1) {
+		if (rw) {
+			ret = fbench_erase(addr, size);
+			if (ret) {
+				break;
+			}
+			ret = fbench_pass(FBENCH_WRITE, addr, size, payload, false, &cycles,
+					  &crc, &errs);
+			if (ret) {
+				break;
+			}
+			fbench_print(shell, payload, "write", size, cycles);
+		}
+
+		crc = 0;
+		ret = fbench_pass(FBENCH_READ, addr, size, payload, rw, &cycles, &crc, &errs);
+		if (ret) {
+			break;
+		}
+		fbench_print(shell, payload, "read", size, cycles);
+
+		/* Without a known pattern every payload size must read the same data */
+		if (payload == FBENCH_MIN_PAYLOAD) {
+			ref_crc = crc;
+		} else if (!rw && crc != ref_crc) {
+			errs++;
+		}
+	}
+
+	if (ret == 0 && errs) {
+		ret = -EIO;
+	}
+	if (ret) {
+		shell_info(shell, "[FAIL] Flash bench: %d, %u mismatches", ret, errs);
+		return ret;
+	}
+	shell_info(shell, "[PASS] Flash bench succeeded! crc32 0x%08x", ref_crc);
+
+	return 0;
+}
+
+/* Print and release captured postcodes with their inter-arrival gaps */
+int espi_p80_drain(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t window[P80_BURST_CODES];
+	uint32_t tail = atomic_get(&p80_tail);
+	uint32_t head = atomic_get(&p80_head);
+	uint32_t lines = UINT32_MAX, count = 0, dropped, rate;
+	uint32_t gap, min_gap = UINT32_MAX, max_gap = 0, burst = UINT32_MAX, last = 0;
+	uint64_t gap_sum = 0;
+	struct p80_rec *rec;
+	char *eptr;
+
+	if (argc > 1) {
+		lines = strtoul(argv[1], &eptr, 0);
+		if (*eptr != '\0') {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Postcode gaps in host cycles");
+#else
+	shell_print(shell, "Postcode gaps in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+	dropped = atomic_set(&p80_dropped, 0);
+
+	for (; tail != head; tail++, count++) {
+		rec = &p80_ring[tail % P80_RING_SIZE];
+		if (count) {
+			gap = rec->cycles - last;
+			gap_sum += gap;
+			min_gap = MIN(min_gap, gap);
+			max_gap = MAX(max_gap, gap);
+		}
+		/* Shortest span of P80_BURST_CODES consecutive codes */
+		if (count >= P80_BURST_CODES - 1) {
+			burst = MIN(burst, rec->cycles - window[(count + 1) % P80_BURST_CODES]);
+		}
+		window[count % P80_BURST_CODES] = rec->cycles;
+
+		if (count < lines) {
+			if (count) {
+				shell_print(shell, "  %5u: 0x%02x +%u", count, rec->code, gap);
+			} else {
+				shell_print(shell, "  %5u: 0x%02x", count, rec->code);
+			}
+		}
+		last = rec->cycles;
+		/* Hand the slot back straight away, the host may still be sending */
+		atomic_set(&p80_tail, tail + 1);
+	}
+
+	shell_print(shell, "%u codes, %u dropped", count, dropped);
+	if (count > 1) {
+		shell_print(shell, "gap min %u, avg %u, max %u", min_gap,
+			    (uint32_t)(gap_sum / (count - 1)), max_gap);
+	}
+	if (count >= P80_BURST_CODES) {
+		rate = test_timing_rate(P80_BURST_CODES - 1, burst);
+		shell_print(shell, "peak burst %u codes in %u cycles", P80_BURST_CODES, burst);
+		if (rate) {
+			shell_print(shell, "peak rate %u codes/s", rate);
+		}
+	}
+
+	if (dropped) {
+		shell_info(shell, "[FAIL] P80 capture dropped %u codes", dropped);
+		return 0;
+	}
+	shell_info(shell, "[PASS] P80 capture succeeded!");
+
+	return 0;
+}
+
+/* VW round trip latency */
+#define VWLAT_TIMEOUT_MS	100
+#define VWLAT_POLL_LOOPS	100000
+
+static struct test_hist vwlat_hist;
+
+/* Send out at level and time the reply signal reaching the same level */
+static int vwlat_run(enum espi_vwire_signal out, enum espi_vwire_signal reply, uint8_t level,
+		     bool poll, uint32_t *lat)
+{
+	uint32_t start, loops;
+	uint8_t val = !level;
+	int ret;
+
+	vwlat_level = level;
+	k_sem_reset(&vwlat_sem);
+	atomic_set(&vwlat_signal, poll ? VWLAT_NONE : reply);
+
+	start = test_timing_cycles();
+	ret = espi_send_vwire(espi_dev, out, level);
+	if (ret) {
+		atomic_set(&vwlat_signal, VWLAT_NONE);
+		return ret;
+	}
+#ifdef CONFIG_ESPI_EMUL
+	/* Nobody on the other side, the host stand-in mirrors the wire */
+	host_emul_vw_reply(reply, level);
+#endif
+
+	if (!poll) {
+		if (k_sem_take(&vwlat_sem, K_MSEC(VWLAT_TIMEOUT_MS))) {
+			atomic_set(&vwlat_signal, VWLAT_NONE);
+			return -ETIMEDOUT;
+		}
+		*lat = vwlat_cycles - start;
+		return 0;
+	}
+
+	for (loops = 0; loops < VWLAT_POLL_LOOPS && val != level; loops++) {
+		ret = espi_receive_vwire(espi_dev, reply, &val);
+		if (ret) {
+			return ret;
+		}
+	}
+	*lat = test_timing_cycles() - start;
+
+	return (val == level) ? 0 : -ETIMEDOUT;
+}
+
+int espi_vw_latency(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t idx, reply, count = 1000, lat, min = UINT32_MAX, timeouts = 0;
+	uint64_t sum = 0;
+	bool poll = false;
+	char *eptr;
+	int ret = 0;
+
+	idx = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0' || idx >= ARRAY_SIZE(vw_out)) {
+		shell_error(shell, "Invalid argument, '%s' is not a vw_out index", argv[1]);
+		return -EINVAL;
+	}
+	reply = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+	if (argc > 3) {
+		count = strtoul(argv[3], &eptr, 0);
+		if (*eptr != '\0' || count == 0) {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", argv[3]);
+			return -EINVAL;
+		}
+	}
+	if (argc > 4) {
+		if (strcmp(argv[4], "poll") != 0) {
+			shell_error(shell, "Invalid argument, '%s'", argv[4]);
+			return -EINVAL;
+		}
+		poll = true;
+	}
+
+	test_hist_reset(&vwlat_hist);
+	for (uint32_t i = 0; i < count; i++) {
+		ret = vwlat_run(vw_out[idx], reply, (i + 1) & 1, poll, &lat);
+		if (ret == -ETIMEDOUT) {
+			timeouts++;
+			continue;
+		}
+		if (ret) {
+			shell_error(shell, "espi_send_vwire failed: %d", ret);
+			break;
+		}
+		test_hist_add(&vwlat_hist, lat);
+		min = MIN(min, lat);
+		sum += lat;
+	}
+
+	shell_print(shell, "VW %u -> %u round trip, %s, %u/%u replies", vw_out[idx], reply,
+		    poll ? "poll" : "callback", test_hist_count(&vwlat_hist), count);
+	if (test_hist_count(&vwlat_hist)) {
+#ifdef TEST_TIMING_HOST_TSC
+		shell_print(shell, "Latency in host cycles");
+#else
+		shell_print(shell, "Latency in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+		shell_print(shell, "min %u, avg %u, p99 %u, max %u", min,
+			    (uint32_t)(sum / test_hist_count(&vwlat_hist)),
+			    test_hist_percentile(&vwlat_hist, 99), test_hist_max(&vwlat_hist));
+		test_hist_print(shell, &vwlat_hist);
+	}
+
+	if (ret || timeouts) {
+		shell_info(shell, "[FAIL] VW latency, %u timeouts", timeouts);
+		return 0;
+	}
+	shell_info(shell, "[PASS] VW latency succeeded!");
+
+	return 0;
+}
+
+/* OOB bulk loopback, the host is expected to echo every packet */
+static struct test_hist oob_tx_hist;
+static struct test_hist oob_rtt_hist;
+
+static void oob_bulk_print(const struct shell *shell, const char *op,
+			   const struct test_hist *hist, uint64_t cycles, uint32_t bytes)
+{
+	uint32_t count = MAX(test_hist_count(hist), 1);
+	uint32_t kbps = test_timing_kbps(bytes, cycles);
+
+	shell_print(shell, "  %-4s | %9u | %9u | %9u | %u.%03u", op, (uint32_t)(cycles / count),
+		    test_hist_percentile(hist, 99), test_hist_max(hist), kbps / 1000U,
+		    kbps % 1000U);
+}
+
+int espi_oob_bulk(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t tx_buf[OOB_HDR_SIZE + OOB_MAX_PAYLOAD];
+	struct espi_oob_packet pckt = { .buf = tx_buf };
+	uint32_t count, len = OOB_MAX_PAYLOAD, seq, rx_seq, start, err_addr;
+	uint32_t ok = 0, lost = 0, data_errs = 0, tx_errs = 0, rx_errs = 0;
+	uint64_t tx_cycles = 0, rtt_cycles = 0;
+	struct test_pattern pat;
+	struct oob_rx *rx;
+	char *eptr;
+	int ret;
+
+	count = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0' || count == 0) {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+	if (argc > 2) {
+		len = strtoul(argv[2], &eptr, 0);
+		if (*eptr != '\0' || len < sizeof(seq) || len > OOB_MAX_PAYLOAD) {
+			shell_error(shell, "Invalid argument, len must be 4 - %u", OOB_MAX_PAYLOAD);
+			return -EINVAL;
+		}
+	}
+
+	tx_buf[0] = OOB_DEST_ADDR;
+	tx_buf[1] = OOB_CMD_CODE;
+	tx_buf[2] = len + 1;	/* byte count includes the source address */
+	tx_buf[3] = OOB_SRC_ADDR;
+	pckt.len = OOB_HDR_SIZE + len;
+	test_hist_reset(&oob_tx_hist);
+	test_hist_reset(&oob_rtt_hist);
+	atomic_clear(&oob_rx_dropped);
+
+	for (seq = 0; seq < count; seq++) {
+		/* Payload: sequence number, then a pattern seeded with it */
+		sys_put_le32(seq, &tx_buf[OOB_HDR_SIZE]);
+		test_pattern_init(&pat, TEST_PATTERN_LFSR, seq, 0);
+		test_pattern_fill(&pat, &tx_buf[OOB_HDR_SIZE + sizeof(seq)], len - sizeof(seq));
+
+		start = test_timing_cycles();
+		ret = oob_send(&pckt);
+		if (ret) {
+			tx_errs++;
+			continue;
+		}
+		test_hist_add(&oob_tx_hist, test_timing_cycles() - start);
+		tx_cycles += test_timing_cycles() - start;
+
+		if (oob_rx_get(&rx)) {
+			rx_errs++;
+			continue;
+		}
+
+		rx_seq = sys_get_le32(&rx->buf[OOB_HDR_SIZE]);
+		test_pattern_init(&pat, TEST_PATTERN_LFSR, rx_seq, 0);
+		if (rx->len != pckt.len) {
+			data_errs++;
+		} else if (rx_seq != seq) {
+			lost++;
+		} else if (test_pattern_verify(&pat, &rx->buf[OOB_HDR_SIZE + sizeof(seq)],
+					       len - sizeof(seq), &err_addr)) {
+			data_errs++;
+		} else {
+			test_hist_add(&oob_rtt_hist, rx->cycles - start);
+			rtt_cycles += rx->cycles - start;
+			ok++;
+		}
+		k_mem_slab_free(&oob_slab, rx);
+	}
+
+	shell_print(shell, "OOB %u packets of %u payload bytes", count, len);
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Latency in host cycles");
+#else
+	shell_print(shell, "Latency in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "  %-4s | %9s | %9s | %9s | %s", "op", "avg", "p99", "max", "MB/s");
+	oob_bulk_print(shell, "tx", &oob_tx_hist, tx_cycles, test_hist_count(&oob_tx_hist) * len);
+	/* Round trip moves the payload both ways */
+	oob_bulk_print(shell, "rtt", &oob_rtt_hist, rtt_cycles, ok * len * 2);
+	shell_print(shell, "%u ok, %u out of sequence, %u data errors, %u tx errors, "
+		    "%u rx errors, %u rx dropped", ok, lost, data_errs, tx_errs, rx_errs,
+		    (uint32_t)atomic_get(&oob_rx_dropped));
+
+	if (ok != count) {
+		shell_info(shell, "[FAIL] OOB bulk, %u of %u packets failed", count - ok, count);
+		return 0;
+	}
+	shell_info(shell, "[PASS] OOB bulk succeeded!");
+
+	return 0;
+}
+
+/*
+ * Host command benchmark. The test plays the host: it writes a protocol v3
+ * request into the ECUSTOM_HOST_CMD_GET_PARAM_MEMORY window, the EC side
+ * validates it, builds the response and reports the result through
+ * ECUSTOM_HOST_CMD_SEND_RESULT. Only the EC side is timed.
+ */
+#define HCMD_VERSION		3
+#define HCMD_HDR_SIZE		8
+#define HCMD_CMD_ECHO		0x0001
+#define HCMD_ECHO_ADD		0x01020304U
+#define HCMD_RES_SUCCESS	0
+#define HCMD_RES_INVALID_CHECKSUM	7
+#define HCMD_RES_INVALID_HEADER	12
+#define HCMD_RES_REQUEST_TRUNCATED	13
+#define HCMD_BAD_CHECKSUM_EVERY	16
+#define HCMD_MAX_SIZE		256
+
+enum hcmd_mode {
+	HCMD_COPY,
+	HCMD_IN_PLACE,
+	HCMD_MODE_NUM,
+};
+
+static const char *const hcmd_mode_names[HCMD_MODE_NUM] = { "copy", "in-place" };
+static uint8_t hcmd_req_buf[HCMD_MAX_SIZE] __aligned(4);
+static uint8_t hcmd_resp_buf[HCMD_MAX_SIZE] __aligned(4);
+static struct test_hist hcmd_hist;
+
+static uint8_t hcmd_sum(const uint8_t *buf, size_t len)
+{
+	uint8_t sum = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		sum += buf[i];
+	}
+
+	return sum;
+}
+
+/* Echo command: every data word comes back with HCMD_ECHO_ADD added */
+static void hcmd_echo(const uint8_t *in, uint8_t *out, size_t len)
+{
+	for (size_t i = 0; i < len; i += 4) {
+		sys_put_le32(sys_get_le32(&in[i]) + HCMD_ECHO_ADD, &out[i]);
+	}
+}
+
+static void hcmd_resp_hdr(uint8_t *resp, uint16_t result, uint16_t len)
+{
+	resp[0] = HCMD_VERSION;
+	resp[1] = 0;
+	sys_put_le16(result, &resp[2]);
+	sys_put_le16(len, &resp[4]);
+	sys_put_le16(0, &resp[6]);
+	resp[1] = -hcmd_sum(resp, HCMD_HDR_SIZE + len);
+}
+
+/* EC side: validate the request in win and leave the response there */
+static uint16_t hcmd_process(uint8_t *win, size_t size, enum hcmd_mode mode)
+{
+	uint8_t *req = (mode == HCMD_COPY) ? hcmd_req_buf : win;
+	uint8_t *resp = (mode == HCMD_COPY) ? hcmd_resp_buf : win;
+	uint16_t len, result = HCMD_RES_SUCCESS;
+
+	if (mode == HCMD_COPY) {
+		memcpy(req, win, HCMD_HDR_SIZE);
+	}
+	len = sys_get_le16(&req[6]);
+	if (req[0] != HCMD_VERSION) {
+		result = HCMD_RES_INVALID_HEADER;
+	} else if (len > size - HCMD_HDR_SIZE || len % 4) {
+		result = HCMD_RES_REQUEST_TRUNCATED;
+	} else {
+		if (mode == HCMD_COPY) {
+			memcpy(&req[HCMD_HDR_SIZE], &win[HCMD_HDR_SIZE], len);
+		}
+		if (hcmd_sum(req, HCMD_HDR_SIZE + len) != 0) {
+			result = HCMD_RES_INVALID_CHECKSUM;
+		}
+	}
+
+	if (result != HCMD_RES_SUCCESS) {
+		len = 0;
+	} else {
+		/* Response data sits at the same offset, so in place works word by word */
+		hcmd_echo(&req[HCMD_HDR_SIZE], &resp[HCMD_HDR_SIZE], len);
+	}
+	hcmd_resp_hdr(resp, result, len);
+
+	if (mode == HCMD_COPY) {
+		memcpy(win, resp, HCMD_HDR_SIZE + len);
+	}
+
+	return result;
+}
+
+/* Host side: write request seq, a bad checksum one in HCMD_BAD_CHECKSUM_EVERY */
+static bool hcmd_host_request(uint8_t *win, uint32_t seq, uint16_t len)
+{
+	bool bad = (seq % HCMD_BAD_CHECKSUM_EVERY) == HCMD_BAD_CHECKSUM_EVERY - 1;
+	struct test_pattern pat;
+
+	win[0] = HCMD_VERSION;
+	win[1] = 0;
+	sys_put_le16(HCMD_CMD_ECHO, &win[2]);
+	win[4] = 0;
+	win[5] = 0;
+	sys_put_le16(len, &win[6]);
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, seq, 0);
+	test_pattern_fill(&pat, &win[HCMD_HDR_SIZE], len);
+	win[1] = -hcmd_sum(win, HCMD_HDR_SIZE + len) + (bad ? 1 : 0);
+
+	return bad;
+}
+
+/* Host side: check the response to request seq */
+static bool hcmd_host_verify(const uint8_t *win, uint32_t seq, uint16_t len, bool bad)
+{
+	uint16_t result = sys_get_le16(&win[2]);
+	uint16_t resp_len = sys_get_le16(&win[4]);
+	struct test_pattern pat;
+	uint32_t word;
+
+	if (win[0] != HCMD_VERSION || hcmd_sum(win, HCMD_HDR_SIZE + MIN(resp_len, len)) != 0) {
+		return false;
+	}
+	if (bad) {
+		return result == HCMD_RES_INVALID_CHECKSUM && resp_len == 0;
+	}
+	if (result != HCMD_RES_SUCCESS || resp_len != len) {
+		return false;
+	}
+
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, seq, 0);
+	for (uint16_t i = 0; i < len; i += 4) {
+		test_pattern_fill(&pat, &word, sizeof(word));
+		if (sys_get_le32(&win[HCMD_HDR_SIZE + i]) != word + HCMD_ECHO_ADD) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int espi_hcmd_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t addr, size, count, len, result, start, rate, errs = 0;
+	uint64_t cycles;
+	uint8_t *win;
+	char *eptr;
+	bool bad;
+	int ret;
+
+	count = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0' || count == 0) {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+
+	if (espi_lpc_read(ECUSTOM_HOST_CMD_GET_PARAM_MEMORY, &addr) ||
+	    espi_lpc_read(ECUSTOM_HOST_CMD_GET_PARAM_MEMORY_SIZE, &size)) {
+		shell_error(shell, "[FAIL] Host command window not available");
+		return -ENODEV;
+	}
+	win = (uint8_t *)addr;
+	size = MIN(size, HCMD_MAX_SIZE);
+	len = size - HCMD_HDR_SIZE;
+
+	if (argc > 2) {
+		len = strtoul(argv[2], &eptr, 0);
+		if (*eptr != '\0' || len % 4 || len > size - HCMD_HDR_SIZE) {
+			shell_error(shell, "Invalid argument, len must be a multiple of 4 up to %u",
+				    size - HCMD_HDR_SIZE);
+			return -EINVAL;
+		}
+	}
+
+	shell_print(shell, "Host command window 0x%08x, %u bytes, %u data bytes per command",
+		    addr, size, len);
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Latency in host cycles");
+#else
+	shell_print(shell, "Latency in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "  %-8s | %9s | %9s | %9s | %s", "response", "avg", "p99", "max",
+		    "cmds/s");
+
+	for (int mode = 0; mode < HCMD_MODE_NUM; mode++) {
+		test_hist_reset(&hcmd_hist);
+		cycles = 0;
+
+		for (uint32_t seq = 0; seq < count; seq++) {
+			bad = hcmd_host_request(win, seq, len);
+
+			start = test_timing_cycles();
+			result = hcmd_process(win, size, mode);
+			ret = espi_lpc_write(ECUSTOM_HOST_CMD_SEND_RESULT, &result);
+			start = test_timing_cycles() - start;
+
+			if (ret) {
+				shell_error(shell, "Send result failed: %d", ret);
+				return ret;
+			}
+			test_hist_add(&hcmd_hist, start);
+			cycles += start;
+
+			if (!hcmd_host_verify(win, seq, len, bad)) {
+				errs++;
+			}
+		}
+
+		rate = test_timing_rate(count, cycles);
+		shell_print(shell, "  %-8s | %9u | %9u | %9u | %u", hcmd_mode_names[mode],
+			    (uint32_t)(cycles / count), test_hist_percentile(&hcmd_hist, 99),
+			    test_hist_max(&hcmd_hist), rate);
+	}
+
+	if (errs) {
+		shell_info(shell, "[FAIL] Host command bench, %u bad responses", errs);
+		return 0;
+	}
+	shell_info(shell, "[PASS] Host command bench succeeded!");
+
+	return 0;
+}
+
+/* 8042 KBC and ACPI output stream */
+#define KBSTREAM_TIMEOUT_MS	100
+
+static struct test_hist kbs_write_hist;
+static struct test_hist kbs_stall_hist;
+
+/* Wait for the host to take the output byte */
+static int kbstream_wait_obe(bool kbc)
+{
+	int64_t deadline;
+	uint32_t obf;
+	int ret;
+
+	if (kbc) {
+		return k_sem_take(&kbc_obe_sem, K_MSEC(KBSTREAM_TIMEOUT_MS)) ? -ETIMEDOUT : 0;
+	}
+
+	/* ACPI has no OBE notification, poll the output buffer full flag */
+	deadline = k_uptime_get() + KBSTREAM_TIMEOUT_MS;
+	do {
+		ret = espi_lpc_read(EACPI_OBF_HAS_CHAR, &obf);
+		if (ret || !obf) {
+			return ret;
+		}
+	} while (k_uptime_get() < deadline);
+
+	return -ETIMEDOUT;
+}
+
+int espi_kb_stream(const struct shell *shell, size_t argc, char **argv)
+{
+	enum lpc_peripheral_opcode op;
+	uint32_t count, sent, data, word = 0, start, begin, elapsed, lat;
+	uint64_t write_cycles = 0, stall_cycles = 0;
+	struct test_pattern pat;
+	char *eptr;
+	bool kbc;
+	int ret = 0;
+
+	if (strcmp(argv[1], "kbc") == 0) {
+		kbc = true;
+		op = E8042_WRITE_KB_CHAR;
+	} else if (strcmp(argv[1], "acpi") == 0) {
+		kbc = false;
+		op = EACPI_WRITE_CHAR;
+	} else {
+		shell_error(shell, "Invalid argument, '%s'", argv[1]);
+		return -EINVAL;
+	}
+	count = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0' || count == 0) {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+
+	test_hist_reset(&kbs_write_hist);
+	test_hist_reset(&kbs_stall_hist);
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, count, 0);
+	k_sem_reset(&kbc_obe_sem);
+	atomic_set(&kbc_streaming, 1);
+
+	begin = test_timing_cycles();
+	for (sent = 0; sent < count; sent++) {
+		if (sent % sizeof(word) == 0) {
+			test_pattern_fill(&pat, &word, sizeof(word));
+		}
+		data = (word >> (8 * (sent % sizeof(word)))) & 0xFF;
+
+		start = test_timing_cycles();
+		ret = espi_lpc_write(op, &data);
+		lat = test_timing_cycles() - start;
+		if (ret) {
+			break;
+		}
+		test_hist_add(&kbs_write_hist, lat);
+		write_cycles += lat;
+
+		/* Stall: the byte is out, waiting for the host to read it */
+		start = test_timing_cycles();
+		ret = kbstream_wait_obe(kbc);
+		lat = test_timing_cycles() - start;
+		if (ret) {
+			break;
+		}
+		test_hist_add(&kbs_stall_hist, lat);
+		stall_cycles += lat;
+	}
+	elapsed = test_timing_cycles() - begin;
+	atomic_set(&kbc_streaming, 0);
+
+	shell_print(shell, "%s stream, %u of %u bytes", kbc ? "KBC" : "ACPI", sent, count);
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Latency in host cycles");
+#else
+	shell_print(shell, "Latency in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+	if (sent) {
+		shell_print(shell, "  write: avg %u, p99 %u, max %u",
+			    (uint32_t)(write_cycles / sent),
+			    test_hist_percentile(&kbs_write_hist, 99),
+			    test_hist_max(&kbs_write_hist));
+		shell_print(shell, "  stall: avg %u, p99 %u, max %u, %u%% of %u cycles",
+			    (uint32_t)(stall_cycles / sent),
+			    test_hist_percentile(&kbs_stall_hist, 99),
+			    test_hist_max(&kbs_stall_hist),
+			    (uint32_t)(stall_cycles * 100U / MAX(elapsed, 1)), elapsed);
+		shell_print(shell, "  rate : %u bytes/s", test_timing_rate(sent, elapsed));
+	}
+
+	if (ret) {
+		shell_info(shell, "[FAIL] %s stream, %s after %u bytes: %d", kbc ? "KBC" : "ACPI",
+			   (ret == -ETIMEDOUT) ? "no OBE" : "write failed", sent, ret);
+		return 0;
+	}
+	shell_info(shell, "[PASS] %s stream succeeded!", kbc ? "KBC" : "ACPI");
+
+	return 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/espi_saf.h>
+#include <zephyr/shell/shell.h>
+#include "taf_util.h"
+#include "test_pattern.h"
+#include "test_timing.h"
+
+/*
+ * Protection region lookup. The TAF driver checks a request against every
+ * region in turn: a region blocks a tag when its read (write) protection is
+ * set, the tag is not in its override mask and the request overlaps
+ * [start, end]. The index splits the address space at every region boundary
+ * into segments and keeps the OR of the tags denied in each one, so a
+ * request costs a binary search plus the few segments it spans.
+ */
+#define TAF_PR_MAX		256
+#define TAF_PR_BOUND_MAX	(2 * TAF_PR_MAX)
+#define TAF_PR_REQ_NUM		1024
+#define TAF_PR_PASSES		16
+/* Regions and requests fall in the first 64 MB, regions are 4 KB aligned */
+#define TAF_PR_SPAN		MB(64)
+#define TAF_PR_PAGE		KB(4)
+#define TAF_PR_MAX_PAGES	256
+
+/* Tags denied, reads in bits 0-15 and writes/erases in bits 16-31 */
+#define TAF_PR_DENY(tag, write)	BIT((tag) + ((write) ? TAF_TAG_NUM : 0))
+
+struct taf_pr_index {
+	uint32_t num;
+	/* Segment i is [bound[i], bound[i + 1]), the last one has no region */
+	uint32_t bound[TAF_PR_BOUND_MAX];
+	uint32_t deny[TAF_PR_BOUND_MAX];
+};
+
+struct taf_pr_req {
+	uint32_t addr;
+	uint32_t len;
+	uint8_t tag;
+	bool write;
+};
+
+static struct espi_saf_pr taf_pr_regions[TAF_PR_MAX];
+static struct taf_pr_index taf_pr_idx;
+static struct taf_pr_req taf_pr_reqs[TAF_PR_REQ_NUM];
+
+/* Same test as the driver, one region after the other */
+static bool taf_pr_linear(const struct espi_saf_pr *pr, size_t num, const struct taf_pr_req *req)
+{
+	for (size_t i = 0; i < num; i++) {
+		if (!(req->write ? pr[i].master_bm_we : pr[i].master_bm_rd) ||
+		    ((req->write ? pr[i].override_w : pr[i].override_r) & BIT(req->tag))) {
+			continue;
+		}
+		if (req->addr + req->len <= pr[i].start || req->addr > pr[i].end) {
+			continue;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+static int taf_pr_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Index of the segment holding addr, 0 also for addresses below every bound */
+static uint32_t taf_pr_find(const struct taf_pr_index *idx, uint32_t addr)
+{
+	uint32_t lo = 0, hi = idx->num;
+
+	/* First bound above addr */
+	while (lo < hi) {
+		uint32_t mid = (lo + hi) / 2;
+
+		if (idx->bound[mid] <= addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo ? lo - 1 : 0;
+}
+
+static void taf_pr_build(struct taf_pr_index *idx, const struct espi_saf_pr *pr, size_t num)
+{
+	uint32_t n = 0, deny;
+
+	for (size_t i = 0; i < num; i++) {
+		idx->bound[n++] = pr[i].start;
+		idx->bound[n++] = pr[i].end + 1;
+	}
+	qsort(idx->bound, n, sizeof(idx->bound[0]), taf_pr_cmp);
+
+	idx->num = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		if (idx->num == 0 || idx->bound[idx->num - 1] != idx->bound[i]) {
+			idx->bound[idx->num] = idx->bound[i];
+			idx->deny[idx->num++] = 0;
+		}
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		deny = 0;
+		if (pr[i].master_bm_rd) {
+			deny |= (uint16_t)~pr[i].override_r;
+		}
+		if (pr[i].master_bm_we) {
+			deny |= (uint32_t)(uint16_t)~pr[i].override_w << TAF_TAG_NUM;
+		}
+		for (uint32_t s = taf_pr_find(idx, pr[i].start); idx->bound[s] <= pr[i].end; s++) {
+			idx->deny[s] |= deny;
+		}
+	}
+}
+
+static bool taf_pr_lookup(const struct taf_pr_index *idx, const struct taf_pr_req *req)
+{
+	uint32_t last = req->addr + req->len - 1;
+	uint32_t deny = 0;
+
+	if (idx->num == 0 || last < idx->bound[0]) {
+		return false;
+	}
+
+	for (uint32_t s = taf_pr_find(idx, req->addr); s < idx->num && idx->bound[s] <= last; s++) {
+		deny |= idx->deny[s];
+	}
+
+	return (deny & TAF_PR_DENY(req->tag, req->write)) != 0;
+}
+
+static uint32_t taf_pr_rand(struct test_pattern *pat)
+{
+	uint32_t word;
+
+	test_pattern_fill(pat, &word, sizeof(word));
+
+	return word;
+}
+
+static void taf_pr_generate(uint32_t num, uint32_t seed)
+{
+	static const uint32_t erase_blk[] = {KB(4), KB(32), KB(64), KB(128)};
+	struct test_pattern pat;
+	struct espi_saf_pr *pr;
+	struct taf_pr_req *req;
+	uint32_t rnd;
+
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, seed, 0);
+
+	for (uint32_t i = 0; i < num; i++) {
+		pr = &taf_pr_regions[i];
+		rnd = taf_pr_rand(&pat);
+		pr->start = ROUND_DOWN(taf_pr_rand(&pat) % TAF_PR_SPAN, TAF_PR_PAGE);
+		pr->end = pr->start + (1 + rnd % TAF_PR_MAX_PAGES) * TAF_PR_PAGE - 1;
+		pr->override_r = rnd >> 16;
+		pr->override_w = taf_pr_rand(&pat);
+		pr->master_bm_rd = (rnd >> 8) & 1;
+		pr->master_bm_we = (rnd >> 9) & 1;
+		pr->pr_num = i;
+		pr->flags = 1;
+	}
+
+	/* Reads and writes of up to 64 bytes, erases of a whole block */
+	for (uint32_t i = 0; i < TAF_PR_REQ_NUM; i++) {
+		req = &taf_pr_reqs[i];
+		rnd = taf_pr_rand(&pat);
+		req->tag = rnd % TAF_TAG_NUM;
+		req->addr = taf_pr_rand(&pat) % TAF_PR_SPAN;
+		switch ((rnd >> 4) % 3) {
+		case 0:
+			req->write = false;
+			req->len = 1 + (rnd >> 8) % 64;
+			break;
+		case 1:
+			req->write = true;
+			req->len = 1 + (rnd >> 8) % 64;
+			break;
+		default:
+			req->write = true;
+			req->len = erase_blk[(rnd >> 8) % ARRAY_SIZE(erase_blk)];
+			req->addr = ROUND_DOWN(req->addr, req->len);
+			break;
+		}
+	}
+}
+
+int cmd_taf_pr_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t start, linear, index, build, denied = 0, seed = 1;
+	volatile uint32_t sink = 0;
+	uint32_t num;
+	char *eptr;
+
+	num = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+	if (num == 0 || num > TAF_PR_MAX) {
+		shell_error(shell, "Invalid argument, regions 1 - %d", TAF_PR_MAX);
+		return -EINVAL;
+	}
+
+	if (argc > 2) {
+		seed = strtoul(argv[2], &eptr, 0);
+		if (*eptr != '\0') {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+			return -EINVAL;
+		}
+	}
+
+	taf_pr_generate(num, seed);
+
+	start = test_timing_cycles();
+	taf_pr_build(&taf_pr_idx, taf_pr_regions, num);
+	build = test_timing_cycles() - start;
+
+	/* Both have to agree on every request before they are timed */
+	for (uint32_t i = 0; i < TAF_PR_REQ_NUM; i++) {
+		bool blocked = taf_pr_linear(taf_pr_regions, num, &taf_pr_reqs[i]);
+
+		if (blocked != taf_pr_lookup(&taf_pr_idx, &taf_pr_reqs[i])) {
+			shell_error(shell, "[FAIL] request 0x%x+%u tag %u %s, linear %d",
+				    taf_pr_reqs[i].addr, taf_pr_reqs[i].len, taf_pr_reqs[i].tag,
+				    taf_pr_reqs[i].write ? "write" : "read", blocked);
+			return 0;
+		}
+		denied += blocked;
+	}
+
+	start = test_timing_cycles();
+	for (int pass = 0; pass < TAF_PR_PASSES; pass++) {
+		for (uint32_t i = 0; i < TAF_PR_REQ_NUM; i++) {
+			sink += taf_pr_linear(taf_pr_regions, num, &taf_pr_reqs[i]);
+		}
+	}
+	linear = test_timing_cycles() - start;
+
+	start = test_timing_cycles();
+	for (int pass = 0; pass < TAF_PR_PASSES; pass++) {
+		for (uint32_t i = 0; i < TAF_PR_REQ_NUM; i++) {
+			sink += taf_pr_lookup(&taf_pr_idx, &taf_pr_reqs[i]);
+		}
+	}
+	index = test_timing_cycles() - start;
+
+	shell_print(shell, "%u regions, %u segments, %d requests, %u denied", num,
+		    taf_pr_idx.num, TAF_PR_REQ_NUM, denied);
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "Cost in host cycles");
+#else
+	shell_print(shell, "Cost in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "linear scan: %u per request",
+		    linear / (TAF_PR_PASSES * TAF_PR_REQ_NUM));
+	shell_print(shell, "index      : %u per request, %u to build",
+		    index / (TAF_PR_PASSES * TAF_PR_REQ_NUM), build);
+
+	shell_info(shell, "[PASS] PR bench succeeded!");
+	shell_info(shell, "[GO]");
+	return 0;
+}
@@ -7,10 +7,15 @@
 #ifndef __TAF_UTIL_H__
 #define __TAF_UTIL_H__
 
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
 #include <zephyr/sys/util.h>
 
 #define CAL_DATA_FROM_ADDR(n) ((uint8_t)(((n) * 3) + 2) + (n >> 11))
 
+/* eSPI tags are 4 bits wide */
+#define TAF_TAG_NUM		16
+
 struct taf_handle_data {
 	uint8_t  taf_type;
 	uint8_t  taf_tag;
@@ -18,9 +23,28 @@ struct taf_handle_data {
 	uint16_t length;
 	uint32_t src[16];
 	uint8_t *buf;
-	struct k_work work;
+	uint32_t notify_cycles;
+	/* Replayed by host_trace, served from flash with no completion on the bus */
+	bool replay;
 };
 
-struct taf_handle_data taf_data;
+/*
+ * FIFO ring of TAF requests. The notification ISR is the only producer and the
+ * TAF work queue the only consumer, head and tail are free running counters.
+ * Slots follow arrival order, not the tag; the tag bitmaps only track state.
+ */
+struct taf_queue {
+	struct taf_handle_data slot[CONFIG_ESPI_TAF_SLOT_NUM];
+	atomic_t head;
+	atomic_t tail;
+	/* Tags queued and not completed yet, and tags dropped on overflow */
+	ATOMIC_DEFINE(pending_tags, TAF_TAG_NUM);
+	ATOMIC_DEFINE(overflow_tags, TAF_TAG_NUM);
+	atomic_t overflow;
+	atomic_t tag_reuse;
+	atomic_t max_depth;
+	atomic_t done;
+	struct k_work work;
+};
 
 #endif /*__TAF_UTIL_H__*/
@@ -17,10 +17,13 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/shell/shell_uart.h>
+#include "espi_trace.h"
+#include "host_trace.h"
 #if defined(CONFIG_ESPI_SAF)
 #include <zephyr/drivers/espi_saf.h>
 #include <zephyr/drivers/flash.h>
 #include "taf_util.h"
+#include "test_hist.h"
 #endif
 #if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
 #include <zephyr/drivers/flash/npcx_flash_api_ex.h>
@@ -61,6 +64,15 @@ static struct espi_callback p80_cb;
 static struct espi_callback espi_taf_cb;
 #endif
 static uint8_t espi_rst_sts;
+
+/* Callbacks the scripted host delivers its events to */
+static struct espi_callback *const host_trace_cbs[] = {
+	&vw_cb,
+	&p80_cb,
+#if defined(CONFIG_ESPI_SAF) && defined(CONFIG_ESPI_FLASH_CHANNEL)
+	&espi_taf_cb,
+#endif
+};
 static uint8_t nand_data_buf[SPI_NAND_PAGE_SIZE];
 
 #ifdef CONFIG_ESPI_FLASH_CHANNEL
@@ -105,22 +117,100 @@ static const struct espi_saf_protection taf_pr_flash = {
 };
 
 void flash_handler(struct k_work *item);
+int cmd_taf_pr_bench(const struct shell *shell, size_t argc, char **argv);
+
+#if defined(CONFIG_ESPI_SAF)
+#define TAF_WQ_STACK_SIZE	1536
+#define TAF_WQ_PRIORITY		-1
+
+static struct taf_queue taf_queue;
+static struct k_work_q taf_wq;
+static const struct k_work_queue_config taf_wq_cfg = {
+	.name = "espi_taf_wq",
+};
+K_THREAD_STACK_DEFINE(taf_wq_stack, TAF_WQ_STACK_SIZE);
+#endif
+
+#if defined(CONFIG_ESPI_SAF)
+/* TAF request latency, split at notification, work start and completion */
+enum taf_stat_op {
+	TAF_STAT_READ,
+	TAF_STAT_WRITE,
+	TAF_STAT_ERASE,
+	TAF_STAT_OP_NUM,
+};
+
+enum taf_stat_stage {
+	TAF_STAT_QUEUE,		/* notification to work start */
+	TAF_STAT_FLASH,		/* work start to completion */
+	TAF_STAT_TOTAL,		/* notification to completion */
+	TAF_STAT_STAGE_NUM,
+};
+
+#define TAF_STAT_SIZE_NUM	4
+
+static struct test_hist taf_hist[TAF_STAT_OP_NUM][TAF_STAT_SIZE_NUM][TAF_STAT_STAGE_NUM];
+/* Bytes moved and time spent in flash per operation, for throughput */
+static atomic_t taf_stat_bytes[TAF_STAT_OP_NUM];
+static atomic_t taf_stat_us[TAF_STAT_OP_NUM];
+
+static const char *const taf_stat_op_names[TAF_STAT_OP_NUM] = {
+	"read", "write", "erase",
+};
+
+static const char *const taf_stat_size_names[TAF_STAT_OP_NUM][TAF_STAT_SIZE_NUM] = {
+	{ "<=64", "<=256", "<=1K", ">1K" },
+	{ "<=64", "<=256", "<=1K", ">1K" },
+	{ "4K", "32K", "64K", "128K" },
+};
+
+/* Erase requests carry the erase block index in length */
+static int taf_stat_size_class(enum taf_stat_op op, uint32_t length)
+{
+	if (op == TAF_STAT_ERASE) {
+		return MIN(length, TAF_STAT_SIZE_NUM - 1);
+	}
+	if (length <= 64) {
+		return 0;
+	} else if (length <= 256) {
+		return 1;
+	} else if (length <= KB(1)) {
+		return 2;
+	}
+
+	return 3;
+}
+
+static void taf_stat_add(enum taf_stat_op op, uint32_t length, uint32_t notify,
+			 uint32_t start, uint32_t done)
+{
+	static const uint32_t erase_blk[TAF_STAT_SIZE_NUM] = {KB(4), KB(32), KB(64), KB(128)};
+	int size = taf_stat_size_class(op, length);
+	struct test_hist *hist = taf_hist[op][size];
+
+	test_hist_add(&hist[TAF_STAT_QUEUE], start - notify);
+	test_hist_add(&hist[TAF_STAT_FLASH], done - start);
+	test_hist_add(&hist[TAF_STAT_TOTAL], done - notify);
+
+	atomic_add(&taf_stat_bytes[op], (op == TAF_STAT_ERASE) ? erase_blk[size] : length);
+	atomic_add(&taf_stat_us[op], k_cyc_to_us_floor32(done - start));
+}
+#endif
 
 static void host_warn_handler(uint32_t signal, uint32_t status)
 {
 	switch (signal) {
 	case ESPI_VWIRE_SIGNAL_HOST_RST_WARN:
-		LOG_INF("Host reset warning %d", status);
 		if (!IS_ENABLED(CONFIG_ESPI_AUTOMATIC_WARNING_ACKNOWLEDGE)) {
-			LOG_INF("HOST RST ACK %d", status);
 			espi_send_vwire(espi_dev, ESPI_VWIRE_SIGNAL_HOST_RST_ACK, status);
+			espi_trace_record(ESPI_TRACE_VW_OUT, ESPI_VWIRE_SIGNAL_HOST_RST_ACK,
+					  status);
 		}
 		break;
 	case ESPI_VWIRE_SIGNAL_SUS_WARN:
-		LOG_INF("Host suspend warning %d", status);
 		if (!IS_ENABLED(CONFIG_ESPI_AUTOMATIC_WARNING_ACKNOWLEDGE)) {
-			LOG_INF("SUS ACK %d", status);
 			espi_send_vwire(espi_dev, ESPI_VWIRE_SIGNAL_SUS_ACK, status);
+			espi_trace_record(ESPI_TRACE_VW_OUT, ESPI_VWIRE_SIGNAL_SUS_ACK, status);
 		}
 		break;
 	default:
@@ -134,7 +224,7 @@ static void espi_reset_handler(const struct device *dev, struct espi_callback *c
 {
 	if (event.evt_type == ESPI_BUS_RESET) {
 		espi_rst_sts = event.evt_data;
-		LOG_INF("eSPI BUS reset %d", event.evt_data);
+		espi_trace_event(event);
 	}
 }
 
@@ -143,19 +233,7 @@ static void espi_ch_handler(const struct device *dev, struct espi_callback *cb,
 			    struct espi_event event)
 {
 	if (event.evt_type == ESPI_BUS_EVENT_CHANNEL_READY) {
-		switch (event.evt_details) {
-		case ESPI_CHANNEL_VWIRE:
-			LOG_INF("VW channel event %x", event.evt_data);
-			break;
-		case ESPI_CHANNEL_FLASH:
-			LOG_INF("Flash channel event %d", event.evt_data);
-			break;
-		case ESPI_CHANNEL_OOB:
-			LOG_INF("OOB channel event %d", event.evt_data);
-			break;
-		default:
-			LOG_ERR("Unknown channel event");
-		}
+		espi_trace_event(event);
 	}
 }
 
@@ -163,15 +241,9 @@ static void vwire_handler(const struct device *dev, struct espi_callback *cb,
 			  struct espi_event event)
 {
 	if (event.evt_type == ESPI_BUS_EVENT_VWIRE_RECEIVED) {
+		espi_trace_event(event);
+
 		switch (event.evt_details) {
-		case ESPI_VWIRE_SIGNAL_PLTRST:
-			LOG_INF("PLT_RST changed %d", event.evt_data);
-			break;
-		case ESPI_VWIRE_SIGNAL_SLP_S3:
-		case ESPI_VWIRE_SIGNAL_SLP_S4:
-		case ESPI_VWIRE_SIGNAL_SLP_S5:
-			LOG_INF("SLP signal changed %d", event.evt_data);
-			break;
 		case ESPI_VWIRE_SIGNAL_SUS_WARN:
 		case ESPI_VWIRE_SIGNAL_HOST_RST_WARN:
 			host_warn_handler(event.evt_details, event.evt_data);
@@ -185,21 +257,12 @@ static void periph_handler(const struct device *dev, struct espi_callback *cb,
 			   struct espi_event event)
 {
 	uint8_t periph_type;
-	uint8_t periph_index;
 
 	periph_type = EVENT_TYPE(event.evt_details);
-	periph_index = EVENT_DETAILS(event.evt_details);
+	espi_trace_event(event);
 
-	switch (periph_type) {
-	case ESPI_PERIPHERAL_DEBUG_PORT80:
-		LOG_INF("Postcode %x", event.evt_data);
-		break;
-	case ESPI_PERIPHERAL_HOST_IO:
-		LOG_INF("ACPI %x", event.evt_data);
+	if (periph_type == ESPI_PERIPHERAL_HOST_IO) {
 		espi_remove_callback(espi_dev, &p80_cb);
-		break;
-	default:
-		LOG_INF("%s periph 0x%x [%x]", __func__, periph_type, event.evt_data);
 	}
 }
 
@@ -213,30 +276,79 @@ static int nand_flash_get_lut(const struct device *flash_dev,
 			   (uintptr_t)NULL, lut_ptr);
 }
 
+/*
+ * Bad blocks cached as a bitmap indexed by block number. The LUT is fetched
+ * from the driver on the first access after an erase or a failed operation
+ * instead of on every request. An invalidate bumps the generation, and the
+ * bitmap is only valid for the generation its fetch started in, so one that
+ * lands during a refresh is not lost.
+ */
+#define NAND_BLOCK_SIZE		KB(128)
+#define NAND_MAX_BLOCKS		2048
+
+static ATOMIC_DEFINE(nand_bb_map, NAND_MAX_BLOCKS);
+static atomic_t nand_bb_gen = ATOMIC_INIT(1);
+static atomic_t nand_bb_valid_gen;
+
+static void nand_bb_invalidate(void)
+{
+	atomic_inc(&nand_bb_gen);
+}
+
+static int nand_bb_refresh(void)
+{
+	struct nand_flash_lut lut_table;
+	atomic_val_t gen = atomic_get(&nand_bb_gen);
+	uint16_t bb_cnt;
+	int ret;
+
+	ret = nand_flash_get_lut(spi_dev, &lut_table);
+	if (ret) {
+		LOG_ERR("Get NAND bad block LUT failed: %d", ret);
+		return ret;
+	}
+
+	bb_cnt = MIN(lut_table.bbt_count, ARRAY_SIZE(lut_table.bbt_list));
+	if (lut_table.bbt_count > bb_cnt) {
+		LOG_WRN("Bad block LUT holds %d of %d blocks", bb_cnt, lut_table.bbt_count);
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(nand_bb_map); i++) {
+		atomic_clear(&nand_bb_map[i]);
+	}
+	for (uint16_t cnt = 0; cnt < bb_cnt; cnt++) {
+		if (lut_table.bbt_list[cnt] < NAND_MAX_BLOCKS) {
+			atomic_set_bit(nand_bb_map, lut_table.bbt_list[cnt]);
+		}
+	}
+	/* Stays invalid if nand_bb_invalidate() ran since the fetch started */
+	atomic_set(&nand_bb_valid_gen, gen);
+
+	return 0;
+}
+
 /* Check access region is invalid or not */
 bool nand_invalid_check(uint32_t addr, uint32_t len)
 {
-	struct nand_flash_lut lut_table;
-	uint8_t bb_cnt;
-	uint16_t cnt;
-	uint32_t st_addr = addr;
-	uint32_t ed_addr = st_addr + len - 1;
-	uint32_t bk_start, bk_end;
-
-	nand_flash_get_lut(spi_dev, &lut_table);
-	bb_cnt = lut_table.bbt_count;
-
-	if (bb_cnt > 0 && bb_cnt < 20) {
-		for (cnt = 0; cnt < bb_cnt; cnt++) {
-			bk_start = KB(128) * lut_table.bbt_list[cnt];
-			bk_end = bk_start + KB(128) - 1;
-			if (bk_start <= ed_addr && st_addr <= bk_end)
-				return true;
+	uint32_t bk_start = addr / NAND_BLOCK_SIZE;
+	uint32_t bk_end = (addr + len - 1) / NAND_BLOCK_SIZE;
+
+	if (atomic_get(&nand_bb_valid_gen) != atomic_get(&nand_bb_gen) && nand_bb_refresh()) {
+		return true;
+	}
+
+	if (bk_end >= NAND_MAX_BLOCKS) {
+		return true;
+	}
+
+	/* A request spans one block, two at most */
+	for (uint32_t bk = bk_start; bk <= bk_end; bk++) {
+		if (atomic_test_bit(nand_bb_map, bk)) {
+			return true;
 		}
-		return false;
-	} else {
-		return false;
 	}
+
+	return false;
 }
 #endif /* CONFIG_FLASH_NPCX_FIU_NAND_INIT */
 
@@ -259,39 +371,80 @@ int taf_npcx_flash_read(const struct device *dev, struct taf_handle_data *info)
 	taf_data.data = (uint8_t *)info->buf;
 	pckt_taf.buf = (uint8_t *)&taf_data;
 
+	if (info->replay) {
+		if (info->length > MAX_TEST_BUF_SIZE) {
+			return -EINVAL;
+		}
+		return flash_read(spi_dev, info->address, info->buf, info->length);
+	}
+
 	return espi_saf_flash_read(dev, &pckt_taf);
 }
 
+#if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
+/*
+ * Pre-erased page used to pad writes to the program unit. A request holds at
+ * most sizeof(info->src) bytes, less than a page, so every write is padded.
+ * Only the TAF work queue writes, one request at a time, so a single page is
+ * enough. The bytes of a request are put back to 0xFF once it is sent,
+ * instead of clearing the page.
+ */
+#define NAND_PROG_SIZE		512
+
+static uint8_t nand_pad_page[NAND_PROG_SIZE] __aligned(4) = {
+	[0 ... NAND_PROG_SIZE - 1] = 0xFF,
+};
+
+BUILD_ASSERT(sizeof(((struct taf_handle_data *)0)->src) <= NAND_PROG_SIZE,
+	     "TAF write payload larger than the NAND program unit");
+#endif
+
 int taf_npcx_flash_write(const struct device *dev, struct taf_handle_data *info)
 {
 	struct espi_taf_npcx_pckt taf_data;
 	struct espi_saf_packet pckt_taf;
-#if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
-	uint8_t data_buf[512];
+	uint32_t len = info->length;
+	uint8_t *data = (uint8_t *)info->src;
+	int ret;
 
-	if (info->length < 512) {
-		memset(data_buf, 0xFF, sizeof(data_buf));
-		memcpy(&data_buf, info->src, info->length);
-		info->length = 512;
+	if (info->length > sizeof(info->src)) {
+		LOG_ERR("TAF write 0x%x:%d over %d bytes", info->address, info->length,
+			(int)sizeof(info->src));
+		return -EINVAL;
 	}
 
-	if (nand_invalid_check(info->address, info->length)) {
+#if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
+	len = NAND_PROG_SIZE;
+	if (nand_invalid_check(info->address, len)) {
 		LOG_ERR("Access NAND flash invalid region");
 		return -EINVAL;
 	}
+
+	memcpy(nand_pad_page, info->src, info->length);
+	data = nand_pad_page;
 #endif
 
 	pckt_taf.flash_addr = info->address;
-	pckt_taf.len = info->length;
+	pckt_taf.len = len;
 	taf_data.tag = info->taf_tag;
+	taf_data.data = data;
+	pckt_taf.buf = (uint8_t *)&taf_data;
+
+	if (info->replay) {
+		ret = flash_write(spi_dev, info->address, data, len);
+	} else {
+		ret = espi_saf_flash_write(dev, &pckt_taf);
+	}
 #if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
-	taf_data.data = (uint8_t *)&data_buf;
-#else
-	taf_data.data = (uint8_t *)info->src;
+	/* A failed program may have marked a new bad block */
+	if (ret) {
+		nand_bb_invalidate();
+	}
+
+	memset(nand_pad_page, 0xFF, info->length);
 #endif
-	pckt_taf.buf = (uint8_t *)&taf_data;
 
-	return espi_saf_flash_write(dev, &pckt_taf);
+	return ret;
 }
 
 int taf_npcx_flash_erase(const struct device *dev, struct taf_handle_data *info)
@@ -300,7 +453,12 @@ int taf_npcx_flash_erase(const struct device *dev, struct taf_handle_data *info)
 	struct espi_saf_packet pckt_taf;
 	uint32_t len;
 	int erase_blk[4] = {KB(4), KB(32), KB(64), KB(128)};
+	int ret;
 
+	if (info->length >= ARRAY_SIZE(erase_blk)) {
+		LOG_ERR("TAF erase code %d", info->length);
+		return -EINVAL;
+	}
 	len = erase_blk[info->length];
 
 #if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
@@ -320,7 +478,17 @@ int taf_npcx_flash_erase(const struct device *dev, struct taf_handle_data *info)
 	taf_data.tag = info->taf_tag;
 	taf_data.data = (uint8_t *)info->buf;
 	pckt_taf.buf = (uint8_t *)&taf_data;
-	return espi_saf_flash_erase(dev, &pckt_taf);
+	if (info->replay) {
+		ret = flash_erase(spi_dev, info->address, len);
+	} else {
+		ret = espi_saf_flash_erase(dev, &pckt_taf);
+	}
+#if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
+	/* Erase may mark a new bad block, reload the LUT on the next access */
+	nand_bb_invalidate();
+#endif
+
+	return ret;
 }
 
 int taf_npcx_flash_unsupport(const struct device *dev, struct taf_handle_data *info)
@@ -328,6 +496,11 @@ int taf_npcx_flash_unsupport(const struct device *dev, struct taf_handle_data *i
 	struct espi_taf_npcx_pckt taf_data;
 	struct espi_saf_packet pckt_taf;
 
+	/* No host issued a replayed request, there is nobody to complete it to */
+	if (info->replay) {
+		return 0;
+	}
+
 	pckt_taf.flash_addr = info->address;
 	pckt_taf.len = info->length;
 	taf_data.tag = info->taf_tag;
@@ -355,14 +528,57 @@ void espi_taf_handler(const struct device *dev, struct taf_handle_data *pckt,
 	memcpy(pckt->src, data_ptr->src, sizeof(pckt->src));
 }
 
+/*
+ * Queue one request, called from the notification ISR, or from the host trace
+ * replay with interrupts locked so the ring still has a single producer.
+ */
+static void taf_queue_put(const struct device *dev, struct espi_event event, bool replay)
+{
+	struct espi_taf_pckt *data_ptr = (struct espi_taf_pckt *)event.evt_data;
+	uint32_t head = atomic_get(&taf_queue.head);
+	uint32_t depth = head - (uint32_t)atomic_get(&taf_queue.tail);
+	uint8_t tag = data_ptr->tag % TAF_TAG_NUM;
+	struct taf_handle_data *slot;
+
+	if (depth >= CONFIG_ESPI_TAF_SLOT_NUM) {
+		atomic_inc(&taf_queue.overflow);
+		if (!replay) {
+			atomic_set_bit(taf_queue.overflow_tags, tag);
+		}
+		return;
+	}
+
+	if (atomic_test_and_set_bit(taf_queue.pending_tags, tag)) {
+		atomic_inc(&taf_queue.tag_reuse);
+	}
+
+	slot = &taf_queue.slot[head % CONFIG_ESPI_TAF_SLOT_NUM];
+	slot->notify_cycles = k_cycle_get_32();
+	espi_taf_handler(dev, slot, event);
+	slot->replay = replay;
+	atomic_set(&taf_queue.head, head + 1);
+
+	if (depth + 1 > (uint32_t)atomic_get(&taf_queue.max_depth)) {
+		atomic_set(&taf_queue.max_depth, depth + 1);
+	}
+}
+
 /* eSPI TAF event handler */
 static void espi_taf_ev_handler(const struct device *dev, struct espi_callback *cb,
 				struct espi_event event)
 {
 	if (event.evt_type == ESPI_BUS_SAF_NOTIFICATION) {
 		if (event.evt_details == ESPI_CHANNEL_FLASH) {
-			espi_taf_handler(dev, &taf_data, event);
-			k_work_submit(&taf_data.work);
+			if (k_is_in_isr()) {
+				taf_queue_put(dev, event, false);
+			} else {
+				/* host_trace replay, keep the notification ISR out meanwhile */
+				unsigned int key = irq_lock();
+
+				taf_queue_put(dev, event, true);
+				irq_unlock(key);
+			}
+			k_work_submit_to_queue(&taf_wq, &taf_queue.work);
 		}
 	}
 }
@@ -409,6 +625,7 @@ int espi_init(void)
 #if defined(CONFIG_ESPI_SAF) && defined(CONFIG_ESPI_FLASH_CHANNEL)
 	espi_add_callback(espi_dev, &espi_taf_cb);
 #endif
+	host_trace_init(espi_dev, host_trace_cbs, ARRAY_SIZE(host_trace_cbs));
 	LOG_INF("complete");
 	return ret;
 }
@@ -521,6 +738,11 @@ static void espi_taf_thread_entry(void)
 
 	LOG_INF("espi device %s is ready", espi_dev->name);
 
+	k_work_queue_init(&taf_wq);
+	k_work_queue_start(&taf_wq, taf_wq_stack, K_THREAD_STACK_SIZEOF(taf_wq_stack),
+			   TAF_WQ_PRIORITY, &taf_wq_cfg);
+	k_work_init(&taf_queue.work, flash_handler);
+
 	espi_init();
 
 	espi_write_lpc_request(espi_dev, ECUSTOM_HOST_SUBS_INTERRUPT_EN, &enable);
@@ -540,29 +762,261 @@ static void espi_taf_thread_entry(void)
 
 	espi_saf_config(taf_dev, &taf_cfg_flash);
 	espi_saf_activate(taf_dev);
+}
 
-	k_work_init(&taf_data.work, flash_handler);
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+/*
+ * Read-ahead model for host reads. Once TAF_RA_SEQ_MIN reads in a row
+ * continue where the previous one ended, the next TAF_RA_SIZE bytes are
+ * prefetched through the flash API after the completion is sent, unless
+ * more requests are queued. A prefetch still runs on the TAF work queue, so
+ * requests arriving during it wait, and that wait is counted. The TAF driver
+ * has no way to complete a read with data the EC supplies, so a hit is still
+ * read by the driver: the cached bytes are checked against it, and the time
+ * of its driver call, completion included, bounds what the cache would save.
+ * Only the TAF work queue fills the cache, writes and erases drop it.
+ */
+#define TAF_RA_SIZE		KB(CONFIG_ESPI_TAF_READ_AHEAD_KB)
+#define TAF_RA_SEQ_MIN		2
+
+static uint8_t taf_ra_buf[TAF_RA_SIZE] __aligned(4);
+
+static struct {
+	atomic_t enabled;
+	uint32_t base;
+	uint32_t len;
+	/* Address following the last read and sequential reads up to it */
+	uint32_t next;
+	uint32_t seq;
+	uint32_t reads;
+	uint32_t hits;
+	uint32_t stale;
+	uint32_t prefetches;
+	/* Prefetches skipped as requests were queued */
+	uint32_t skipped;
+	uint32_t invalidates;
+	/* Requests that arrived during a prefetch and the time they waited */
+	uint32_t delayed;
+	uint64_t hit_cycles;
+	uint64_t prefetch_cycles;
+	uint64_t delay_cycles;
+} taf_ra = {
+	.enabled = ATOMIC_INIT(1),
+};
+
+/* TAF work queue only, like every other access to the cache */
+static void taf_ra_invalidate(uint32_t addr, uint32_t len)
+{
+	if (taf_ra.len && addr < taf_ra.base + taf_ra.len && taf_ra.base < addr + len) {
+		taf_ra.len = 0;
+		taf_ra.invalidates++;
+	}
 }
 
-void flash_handler(struct k_work *item)
+/*
+ * Requests from the shell, applied by a work item on the TAF work queue so
+ * they never race a read or a prefetch. A drop empties the whole buffer.
+ */
+enum taf_ra_req {
+	TAF_RA_REQ_DROP,
+	TAF_RA_REQ_RESET,
+	TAF_RA_REQ_NUM,
+};
+
+static ATOMIC_DEFINE(taf_ra_reqs, TAF_RA_REQ_NUM);
+
+static void taf_ra_req_handler(struct k_work *work)
+{
+	if (atomic_test_and_clear_bit(taf_ra_reqs, TAF_RA_REQ_DROP)) {
+		taf_ra_invalidate(0, UINT32_MAX);
+	}
+
+	if (atomic_test_and_clear_bit(taf_ra_reqs, TAF_RA_REQ_RESET)) {
+		taf_ra.reads = 0;
+		taf_ra.hits = 0;
+		taf_ra.stale = 0;
+		taf_ra.prefetches = 0;
+		taf_ra.skipped = 0;
+		taf_ra.invalidates = 0;
+		taf_ra.delayed = 0;
+		taf_ra.hit_cycles = 0;
+		taf_ra.prefetch_cycles = 0;
+		taf_ra.delay_cycles = 0;
+	}
+}
+
+static K_WORK_DEFINE(taf_ra_req_work, taf_ra_req_handler);
+
+static void taf_ra_request(enum taf_ra_req req)
+{
+	atomic_set_bit(taf_ra_reqs, req);
+	k_work_submit_to_queue(&taf_wq, &taf_ra_req_work);
+}
+
+/* Requests queued behind the one being processed */
+static uint32_t taf_ra_queued(void)
+{
+	return (uint32_t)atomic_get(&taf_queue.head) - (uint32_t)atomic_get(&taf_queue.tail) - 1;
+}
+
+static void taf_ra_prefetch(uint32_t addr)
+{
+	uint32_t start = k_cycle_get_32();
+	uint32_t tail = atomic_get(&taf_queue.tail) + 1;
+	uint32_t head, end, from;
+
+	taf_ra.len = 0;
+#if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
+	if (nand_invalid_check(addr, TAF_RA_SIZE)) {
+		return;
+	}
+#endif
+	if (flash_read(spi_dev, addr, taf_ra_buf, TAF_RA_SIZE)) {
+		return;
+	}
+
+	taf_ra.base = addr;
+	taf_ra.len = TAF_RA_SIZE;
+	taf_ra.prefetches++;
+	end = k_cycle_get_32();
+	taf_ra.prefetch_cycles += end - start;
+
+	/* Every request that came in meanwhile waited from its notification on */
+	head = atomic_get(&taf_queue.head);
+	for (; tail != head; tail++) {
+		from = taf_queue.slot[tail % CONFIG_ESPI_TAF_SLOT_NUM].notify_cycles;
+		taf_ra.delayed++;
+		taf_ra.delay_cycles += end - from;
+	}
+}
+
+/* Called once the driver completed a read, flash is the cycles of its call */
+static void taf_ra_read(struct taf_handle_data *info, uint32_t flash)
+{
+	uint32_t addr = info->address;
+	uint32_t len = info->length;
+	uint32_t offs = addr - taf_ra.base;
+
+	if (!atomic_get(&taf_ra.enabled)) {
+		return;
+	}
+
+	taf_ra.reads++;
+	if (taf_ra.len && addr >= taf_ra.base && offs + len <= taf_ra.len) {
+		taf_ra.hits++;
+		taf_ra.hit_cycles += flash;
+		if (memcmp(&taf_ra_buf[offs], info->buf, len) != 0) {
+			taf_ra.stale++;
+		}
+	}
+
+	taf_ra.seq = (addr == taf_ra.next) ? taf_ra.seq + 1 : 0;
+	taf_ra.next = addr + len;
+
+	/* Refill once the stream runs past the cached window, if nothing is waiting */
+	if (taf_ra.seq >= TAF_RA_SEQ_MIN &&
+	    !(taf_ra.len && taf_ra.next >= taf_ra.base &&
+	      taf_ra.next - taf_ra.base + len <= taf_ra.len)) {
+		if (taf_ra_queued() != 0) {
+			taf_ra.skipped++;
+		} else {
+			taf_ra_prefetch(taf_ra.next);
+		}
+	}
+}
+#endif /* CONFIG_ESPI_TAF_READ_AHEAD */
+
+static void taf_process(struct taf_handle_data *info)
 {
-	struct taf_handle_data *info = CONTAINER_OF(item, struct taf_handle_data, work);
+	uint32_t notify = info->notify_cycles;
+	uint32_t length = info->length;
+	uint32_t start = k_cycle_get_32();
+	enum taf_stat_op op = TAF_STAT_OP_NUM;
+	uint32_t done;
 	int ret = 0;
 
 	switch (info->taf_type & 0x0F) {
 	case NPCX_ESPI_TAF_REQ_READ:
-		ret = taf_npcx_flash_read(taf_dev, &taf_data);
+		op = TAF_STAT_READ;
+		ret = taf_npcx_flash_read(taf_dev, info);
 		break;
 	case NPCX_ESPI_TAF_REQ_ERASE:
-		ret = taf_npcx_flash_erase(taf_dev, &taf_data);
+		op = TAF_STAT_ERASE;
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+		/* Largest erase block, dropping more than needed is harmless */
+		taf_ra_invalidate(info->address, KB(128));
+#endif
+		ret = taf_npcx_flash_erase(taf_dev, info);
 		break;
 	case NPCX_ESPI_TAF_REQ_WRITE:
-		ret = taf_npcx_flash_write(taf_dev, &taf_data);
+		op = TAF_STAT_WRITE;
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+		taf_ra_invalidate(info->address, length);
+#endif
+		ret = taf_npcx_flash_write(taf_dev, info);
 		break;
 	}
 
 	if (ret != 0) {
-		ret = taf_npcx_flash_unsupport(taf_dev, &taf_data);
+		taf_npcx_flash_unsupport(taf_dev, info);
+	}
+
+	done = k_cycle_get_32();
+	if (op != TAF_STAT_OP_NUM) {
+		taf_stat_add(op, length, notify, start, done);
+	}
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+	/* After the completion, a prefetch only delays requests arriving during it */
+	if (op == TAF_STAT_READ && ret == 0) {
+		taf_ra_read(info, done - start);
+	}
+#endif
+}
+
+/*
+ * Clear the pending bit of the tag of slot idx. The host may already have
+ * reused the tag for a request queued behind, once the completion was out, so
+ * set it back if so. head is read after the clear, a request queued before is
+ * seen and one queued after sets the bit itself.
+ */
+static void taf_queue_release_tag(struct taf_queue *queue, uint32_t idx)
+{
+	uint8_t tag = queue->slot[idx % CONFIG_ESPI_TAF_SLOT_NUM].taf_tag % TAF_TAG_NUM;
+	uint32_t head;
+
+	atomic_clear_bit(queue->pending_tags, tag);
+	head = atomic_get(&queue->head);
+	for (uint32_t i = idx + 1; i != head; i++) {
+		if (queue->slot[i % CONFIG_ESPI_TAF_SLOT_NUM].taf_tag % TAF_TAG_NUM == tag) {
+			atomic_set_bit(queue->pending_tags, tag);
+			return;
+		}
+	}
+}
+
+/* Drain queued requests in arrival order, then fail the ones that overflowed */
+void flash_handler(struct k_work *item)
+{
+	struct taf_queue *queue = CONTAINER_OF(item, struct taf_queue, work);
+	struct taf_handle_data info = { 0 };
+	uint32_t tail = atomic_get(&queue->tail);
+	struct taf_handle_data *slot;
+
+	while (tail != (uint32_t)atomic_get(&queue->head)) {
+		slot = &queue->slot[tail % CONFIG_ESPI_TAF_SLOT_NUM];
+		taf_process(slot);
+		/* The completion is sent, the host may reuse the tag from now on */
+		taf_queue_release_tag(queue, tail);
+		atomic_set(&queue->tail, ++tail);
+		atomic_inc(&queue->done);
+	}
+
+	for (int tag = 0; tag < TAF_TAG_NUM; tag++) {
+		if (atomic_test_and_clear_bit(queue->overflow_tags, tag)) {
+			info.taf_tag = tag;
+			info.buf = tx_buf_data;
+			taf_npcx_flash_unsupport(taf_dev, &info);
+		}
 	}
 }
 
@@ -591,6 +1045,13 @@ static int flash_erase_cmd(const struct shell *shell, size_t argc, char **argv)
 	}
 
 	ret = flash_erase(spi_dev, addr, KB(128));
+#if defined(CONFIG_FLASH_NPCX_FIU_NAND_INIT)
+	nand_bb_invalidate();
+#endif
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+	/* Once erased, so a prefetch running meanwhile is dropped too */
+	taf_ra_request(TAF_RA_REQ_DROP);
+#endif
 	if (ret != 0) {
 		LOG_ERR("flash erase failed: %d", ret);
 		return -ENODEV;
@@ -606,7 +1067,7 @@ static int flash_write_cmd(const struct shell *shell, size_t argc, char **argv)
 	uint32_t data_sz_in = 0x10000U;
 	uint32_t wr_size;
 	char *eptr;
-	int i, ret;
+	int i, ret = 0;
 	uint32_t addr_in = strtoul(argv[1], &eptr, 0);
 
 	if (*eptr != '\0') {
@@ -635,14 +1096,22 @@ static int flash_write_cmd(const struct shell *shell, size_t argc, char **argv)
 
 		ret = flash_write(spi_dev, addr_in, nand_data_buf, wr_size);
 		if (ret != 0) {
-			LOG_ERR("flash erase failed: %d", ret);
-			return -ENODEV;
+			break;
 		}
 
 		data_sz_in -= wr_size;
 		addr_in += wr_size;
 	}
 
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+	/* Once written, so a prefetch running meanwhile is dropped too */
+	taf_ra_request(TAF_RA_REQ_DROP);
+#endif
+	if (ret != 0) {
+		LOG_ERR("flash erase failed: %d", ret);
+		return -ENODEV;
+	}
+
 	LOG_INF("Flash write succeeded!");
 	LOG_INF("[GO]");
 	return 0;
@@ -769,6 +1238,120 @@ static int cmd_set_taf_mode(const struct shell *shell, size_t argc, char **argv)
 	return 0;
 }
 
+static void taf_stat_print(const struct shell *shell, const struct test_hist *hist)
+{
+	shell_fprintf(shell, SHELL_NORMAL, " | %6u %6u %6u",
+		      k_cyc_to_us_ceil32(test_hist_percentile(hist, 50)),
+		      k_cyc_to_us_ceil32(test_hist_percentile(hist, 99)),
+		      k_cyc_to_us_ceil32(test_hist_max(hist)));
+}
+
+static int cmd_taf_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	struct test_hist *hist;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_error(shell, "Invalid argument, '%s'", argv[1]);
+			return -EINVAL;
+		}
+		for (int i = 0; i < TAF_STAT_OP_NUM; i++) {
+			for (int j = 0; j < TAF_STAT_SIZE_NUM; j++) {
+				for (int k = 0; k < TAF_STAT_STAGE_NUM; k++) {
+					test_hist_reset(&taf_hist[i][j][k]);
+				}
+			}
+		}
+		for (int i = 0; i < TAF_STAT_OP_NUM; i++) {
+			atomic_clear(&taf_stat_bytes[i]);
+			atomic_clear(&taf_stat_us[i]);
+		}
+		atomic_clear(&taf_queue.done);
+		atomic_clear(&taf_queue.max_depth);
+		atomic_clear(&taf_queue.overflow);
+		atomic_clear(&taf_queue.tag_reuse);
+		return 0;
+	}
+
+	shell_print(shell, "Requests: %u done, %u queued, max depth %u/%d, %u overflow, "
+		    "%u tag reuse", (uint32_t)atomic_get(&taf_queue.done),
+		    (uint32_t)(atomic_get(&taf_queue.head) - atomic_get(&taf_queue.tail)),
+		    (uint32_t)atomic_get(&taf_queue.max_depth), CONFIG_ESPI_TAF_SLOT_NUM,
+		    (uint32_t)atomic_get(&taf_queue.overflow),
+		    (uint32_t)atomic_get(&taf_queue.tag_reuse));
+	for (int i = 0; i < TAF_STAT_OP_NUM; i++) {
+		uint32_t bytes = atomic_get(&taf_stat_bytes[i]);
+		uint32_t us = atomic_get(&taf_stat_us[i]);
+
+		if (us == 0) {
+			continue;
+		}
+		shell_print(shell, "%-5s: %u bytes in %u us of flash time, %u KB/s",
+			    taf_stat_op_names[i], bytes, us,
+			    (uint32_t)((uint64_t)bytes * 1000U / us));
+	}
+	shell_print(shell, "Latency in us, p50/p99 are log2 bucket upper bounds");
+	shell_print(shell, "%-5s %-5s | %6s | %20s | %20s | %20s", "op", "size", "count",
+		    "queue p50/p99/max", "flash p50/p99/max", "total p50/p99/max");
+	for (int i = 0; i < TAF_STAT_OP_NUM; i++) {
+		for (int j = 0; j < TAF_STAT_SIZE_NUM; j++) {
+			hist = taf_hist[i][j];
+			if (test_hist_count(&hist[TAF_STAT_TOTAL]) == 0) {
+				continue;
+			}
+
+			shell_fprintf(shell, SHELL_NORMAL, "%-5s %-5s | %6u", taf_stat_op_names[i],
+				      taf_stat_size_names[i][j],
+				      test_hist_count(&hist[TAF_STAT_TOTAL]));
+			for (int k = 0; k < TAF_STAT_STAGE_NUM; k++) {
+				taf_stat_print(shell, &hist[k]);
+			}
+			shell_fprintf(shell, SHELL_NORMAL, "\n");
+		}
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+static int cmd_taf_readahead(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t hit_us, prefetch_us, delay_us;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "on") == 0) {
+			atomic_set(&taf_ra.enabled, 1);
+		} else if (strcmp(argv[1], "off") == 0) {
+			atomic_clear(&taf_ra.enabled);
+		} else if (strcmp(argv[1], "reset") == 0) {
+			taf_ra_request(TAF_RA_REQ_RESET);
+		} else {
+			shell_error(shell, "Invalid argument, '%s'", argv[1]);
+			return -EINVAL;
+		}
+		return 0;
+	}
+
+	hit_us = (uint32_t)k_cyc_to_us_floor64(taf_ra.hit_cycles);
+	prefetch_us = (uint32_t)k_cyc_to_us_floor64(taf_ra.prefetch_cycles);
+	delay_us = (uint32_t)k_cyc_to_us_floor64(taf_ra.delay_cycles);
+	shell_print(shell, "Read-ahead %u KB %s: %u reads, %u hits (%u%%), %u stale",
+		    CONFIG_ESPI_TAF_READ_AHEAD_KB, atomic_get(&taf_ra.enabled) ? "on" : "off",
+		    taf_ra.reads, taf_ra.hits,
+		    taf_ra.reads ? (uint32_t)((uint64_t)taf_ra.hits * 100U / taf_ra.reads) : 0,
+		    taf_ra.stale);
+	shell_print(shell, "%u prefetches, %u skipped as requests were queued, %u invalidates",
+		    taf_ra.prefetches, taf_ra.skipped, taf_ra.invalidates);
+	shell_print(shell, "%u requests delayed by a prefetch, %u us in total", taf_ra.delayed,
+		    delay_us);
+	/* The driver call of a hit also sends the completion, so this overstates */
+	shell_print(shell, "Driver time of hits %u us, prefetch time %u us, saving at most %d us",
+		    hit_us, prefetch_us, (int32_t)(hit_us - prefetch_us));
+
+	return 0;
+}
+#endif
+
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_espi,
 	SHELL_CMD_ARG(flash_erase, NULL, "espi_taf flash_erase <addr>",
 		flash_erase_cmd, 2, 0),
@@ -785,6 +1368,14 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_espi,
 	SHELL_CMD_ARG(set_taf_mode, NULL, "espi_taf set_taf_mode <val>, val = 0 - 1",
 		cmd_set_taf_mode, 2, 0),
 	SHELL_CMD(set_pr, NULL, "espi_taf set_pr", cmd_flash_protection),
+	SHELL_CMD_ARG(pr_bench, NULL, "espi_taf pr_bench <regions> [seed]: protection check cost",
+		cmd_taf_pr_bench, 2, 1),
+	SHELL_CMD_ARG(stats, NULL, "espi_taf stats [reset]: TAF request latency",
+		cmd_taf_stats, 1, 1),
+#if defined(CONFIG_ESPI_TAF_READ_AHEAD)
+	SHELL_CMD_ARG(readahead, NULL, "espi_taf readahead [on|off|reset]: read-ahead hit rate",
+		cmd_taf_readahead, 1, 1),
+#endif
 	SHELL_SUBCMD_SET_END /* Array terminated. */
 );
 
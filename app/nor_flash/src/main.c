@@ -14,6 +14,8 @@
 #include <zephyr/pm/policy.h>
 #include <zephyr/shell/shell.h>
 #include <zephyr/shell/shell_uart.h>
+#include <zephyr/sys/crc.h>
+#include "test_pattern.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -628,6 +630,406 @@ static int nor_flash_write_only(const struct device *flash_dev, off_t addr, size
 	return 0;
 }
 
+/* Throughput benchmark */
+#define BENCH_MIN_CHUNK_SIZE 16
+#define BENCH_MAX_CHUNK_SIZE KB(64)
+#define BENCH_BUF_SIZE MIN(CONFIG_NOR_FLASH_BENCH_BUF_SIZE, BENCH_MAX_CHUNK_SIZE)
+
+static uint8_t bench_buf[BENCH_BUF_SIZE] __aligned(4);
+
+struct bench_result {
+	uint64_t cycles;
+	uint32_t ops;
+};
+
+static size_t bench_erase_unit(const struct device *flash_dev, off_t addr, size_t size)
+{
+#ifdef CONFIG_FLASH_PAGE_LAYOUT
+	struct flash_pages_info info;
+
+	if (flash_get_page_info_by_offs(flash_dev, addr, &info) == 0 && info.size != 0) {
+		return info.size;
+	}
+#endif /* CONFIG_FLASH_PAGE_LAYOUT */
+	return size;
+}
+
+static int bench_erase(const struct device *flash_dev, off_t addr, size_t size,
+		       struct bench_result *res)
+{
+	size_t unit = bench_erase_unit(flash_dev, addr, size);
+	size_t erase_size;
+	uint32_t start;
+	int rc;
+
+	while (size) {
+		erase_size = MIN(size, unit);
+
+		start = k_cycle_get_32();
+		rc = flash_erase(flash_dev, addr, erase_size);
+		res->cycles += k_cycle_get_32() - start;
+		res->ops++;
+		if (rc != 0) {
+			LOG_ERR("flash_erase() failed: %d", rc);
+			return -ENODEV;
+		}
+
+		addr += erase_size;
+		size -= erase_size;
+	}
+
+	return 0;
+}
+
+static int bench_program(const struct device *flash_dev, off_t addr, size_t size,
+			 size_t chunk, struct bench_result *res)
+{
+	size_t write_size;
+	uint32_t start;
+	int rc;
+
+	while (size) {
+		write_size = MIN(size, chunk);
+
+		start = k_cycle_get_32();
+		rc = flash_write(flash_dev, addr, bench_buf, write_size);
+		res->cycles += k_cycle_get_32() - start;
+		res->ops++;
+		if (rc != 0) {
+			LOG_ERR("flash_write() failed: %d", rc);
+			return -ENODEV;
+		}
+
+		addr += write_size;
+		size -= write_size;
+	}
+
+	return 0;
+}
+
+static int bench_read(const struct device *flash_dev, off_t addr, size_t size,
+		      size_t chunk, struct bench_result *res)
+{
+	size_t read_size;
+	uint32_t start;
+	uint32_t i;
+	int rc;
+
+	while (size) {
+		read_size = MIN(size, chunk);
+
+		start = k_cycle_get_32();
+		rc = flash_read(flash_dev, addr, bench_buf, read_size);
+		res->cycles += k_cycle_get_32() - start;
+		res->ops++;
+		if (rc != 0) {
+			LOG_ERR("flash_read() failed: %d", rc);
+			return -ENODEV;
+		}
+
+		/* Every chunk was programmed from the start of bench_buf */
+		for (i = 0; i < read_size; i++) {
+			if (bench_buf[i] != temp_write_buf[i % TEMP_DATA_BUF_SIZE]) {
+				LOG_ERR("flash_read() check failed. A: 0x%lx, D: 0x%x, G: 0x%x",
+					(addr + i), bench_buf[i],
+					temp_write_buf[i % TEMP_DATA_BUF_SIZE]);
+				return -ENODEV;
+			}
+		}
+
+		addr += read_size;
+		size -= read_size;
+	}
+
+	return 0;
+}
+
+static void bench_print_result(size_t size, const struct bench_result *res)
+{
+	uint64_t us = k_cyc_to_us_floor64(res->cycles);
+	uint32_t kbps;
+
+	if (us == 0 || res->ops == 0) {
+		shell_printk(" |     -.--- MB/s        - us");
+		return;
+	}
+
+	/* bytes per microsecond equals MB/s, keep three decimals */
+	kbps = (uint32_t)(((uint64_t)size * 1000U) / us);
+	shell_printk(" | %5u.%03u MB/s %8u us", kbps / 1000U, kbps % 1000U,
+		     (uint32_t)(us / res->ops));
+}
+
+static int nor_flash_bench(const struct device *flash_dev, off_t addr, size_t size,
+			   size_t max_chunk)
+{
+	struct bench_result erase, prog, read;
+	size_t unit = bench_erase_unit(flash_dev, addr, size);
+	size_t chunk;
+	uint32_t i;
+	int rc;
+
+	/* A partial erase unit would fail halfway through the first pass */
+	if (addr % unit != 0 || size % unit != 0) {
+		shell_error(test_objs.shell, "[FAIL] %s: addr 0x%lx and size 0x%x must be "
+			    "aligned to the 0x%x erase unit", flash_dev->name, addr, size, unit);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < BENCH_BUF_SIZE; i++) {
+		bench_buf[i] = temp_write_buf[i % TEMP_DATA_BUF_SIZE];
+	}
+
+	shell_printk("%s: addr 0x%lx, size 0x%x\n", flash_dev->name, addr, size);
+	shell_printk("   chunk |   erase          per op"
+		     "        |   program        per op"
+		     "        |   read           per op\n");
+
+	for (chunk = BENCH_MIN_CHUNK_SIZE; chunk <= max_chunk; chunk <<= 1) {
+		memset(&erase, 0, sizeof(erase));
+		memset(&prog, 0, sizeof(prog));
+		memset(&read, 0, sizeof(read));
+
+		rc = bench_erase(flash_dev, addr, size, &erase);
+		if (rc == 0) {
+			rc = bench_program(flash_dev, addr, size, chunk, &prog);
+		}
+		if (rc == 0) {
+			rc = bench_read(flash_dev, addr, size, chunk, &read);
+		}
+
+		/* Reading back overwrites the pattern, restore it before the next pass */
+		for (i = 0; i < chunk; i++) {
+			bench_buf[i] = temp_write_buf[i % TEMP_DATA_BUF_SIZE];
+		}
+
+		if (rc != 0) {
+			shell_error(test_objs.shell, "[FAIL] Flash bench chunk %u", chunk);
+			return rc;
+		}
+
+		shell_printk("%8u", chunk);
+		bench_print_result(size, &erase);
+		bench_print_result(size, &prog);
+		bench_print_result(size, &read);
+		shell_printk("\n");
+	}
+
+	return 0;
+}
+
+
+/* Streaming verify engine */
+#define STREAM_BUF_SIZE CONFIG_NOR_FLASH_VERIFY_BUF_SIZE
+#define STREAM_BUF_NUM 2
+#define STREAM_READER_STACK_SIZE 1024
+#define STREAM_READER_PRIORITY 7
+
+BUILD_ASSERT((STREAM_BUF_SIZE % sizeof(uint32_t)) == 0,
+	     "Verify buffer must hold whole words");
+
+enum stream_expect {
+	STREAM_EXPECT_NONE,
+	STREAM_EXPECT_ERASED,
+	STREAM_EXPECT_PATTERN,
+};
+
+static uint32_t stream_buf[STREAM_BUF_NUM][STREAM_BUF_SIZE / sizeof(uint32_t)];
+static size_t stream_len[STREAM_BUF_NUM];
+static struct k_sem stream_full[STREAM_BUF_NUM];
+static struct k_sem stream_empty[STREAM_BUF_NUM];
+static struct k_thread stream_reader_id;
+K_THREAD_STACK_DEFINE(stream_reader_stack, STREAM_READER_STACK_SIZE);
+
+static struct {
+	const struct device *dev;
+	off_t addr;
+	size_t size;
+	enum stream_expect expect;
+	struct test_pattern pat;
+	uint32_t crc;
+	uint32_t first_err;
+	uint32_t err_words;
+	int rc;
+} stream_objs;
+
+/* Fill the read buffers one after another while the verifier drains the other one */
+static void stream_reader(void *dummy1, void *dummy2, void *dummy3)
+{
+	off_t read_addr = stream_objs.addr;
+	size_t temp_size = stream_objs.size;
+	uint8_t idx = 0;
+	int rc;
+
+	while (temp_size) {
+		k_sem_take(&stream_empty[idx], K_FOREVER);
+
+		stream_len[idx] = MIN(temp_size, STREAM_BUF_SIZE);
+		rc = flash_read(stream_objs.dev, read_addr, stream_buf[idx], stream_len[idx]);
+		if (rc != 0) {
+			LOG_ERR("flash_read() failed: %d", rc);
+			stream_objs.rc = -ENODEV;
+			stream_len[idx] = 0;
+			k_sem_give(&stream_full[idx]);
+			return;
+		}
+
+		read_addr += stream_len[idx];
+		temp_size -= stream_len[idx];
+		k_sem_give(&stream_full[idx]);
+		idx ^= 1;
+	}
+}
+
+static void stream_check(off_t addr, const uint32_t *buf, size_t len)
+{
+	uint32_t words = len / sizeof(uint32_t);
+	uint32_t errors = 0;
+	uint32_t err_addr;
+	uint32_t i;
+
+	stream_objs.crc = crc32_ieee_update(stream_objs.crc, (const uint8_t *)buf, len);
+	if (stream_objs.expect == STREAM_EXPECT_PATTERN) {
+		errors = test_pattern_verify(&stream_objs.pat, buf, len, &err_addr);
+	} else if (stream_objs.expect == STREAM_EXPECT_ERASED) {
+		for (i = 0; i < words; i++) {
+			if (buf[i] != UINT32_MAX && errors++ == 0) {
+				err_addr = addr + i * sizeof(uint32_t);
+			}
+		}
+	}
+
+	if (errors != 0) {
+		if (stream_objs.err_words == 0) {
+			stream_objs.first_err = err_addr;
+			LOG_ERR("Verify failed. A: 0x%x", err_addr);
+		}
+		stream_objs.err_words += errors;
+	}
+}
+
+static int nor_flash_stream_verify(const struct device *flash_dev, off_t addr, size_t size,
+				   enum stream_expect expect, enum test_pattern_type type)
+{
+	off_t check_addr = addr;
+	size_t temp_size = size;
+	uint8_t idx = 0;
+
+	stream_objs.dev = flash_dev;
+	stream_objs.addr = addr;
+	stream_objs.size = size;
+	stream_objs.expect = expect;
+	test_pattern_init(&stream_objs.pat, type, 0, addr);
+	stream_objs.crc = 0;
+	stream_objs.first_err = 0;
+	stream_objs.err_words = 0;
+	stream_objs.rc = 0;
+
+	for (int i = 0; i < STREAM_BUF_NUM; i++) {
+		k_sem_init(&stream_full[i], 0, 1);
+		k_sem_init(&stream_empty[i], 1, 1);
+	}
+
+	k_thread_create(&stream_reader_id, stream_reader_stack,
+			K_THREAD_STACK_SIZEOF(stream_reader_stack), stream_reader,
+			NULL, NULL, NULL, STREAM_READER_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&stream_reader_id, "nor_flash_reader");
+
+	while (temp_size) {
+		k_sem_take(&stream_full[idx], K_FOREVER);
+		if (stream_objs.rc != 0) {
+			break;
+		}
+
+		stream_check(check_addr, stream_buf[idx], stream_len[idx]);
+		check_addr += stream_len[idx];
+		temp_size -= stream_len[idx];
+		k_sem_give(&stream_empty[idx]);
+		idx ^= 1;
+	}
+
+	k_thread_join(&stream_reader_id, K_FOREVER);
+
+	if (stream_objs.rc != 0) {
+		return stream_objs.rc;
+	}
+
+	return (stream_objs.err_words == 0) ? 0 : -EIO;
+}
+
+static void nor_flash_stream_report(const char *op, size_t size, uint32_t cycles)
+{
+	uint32_t ms = k_cyc_to_ms_floor32(cycles);
+
+	shell_info(test_objs.shell, "%s: crc32 0x%08x, %u bytes in %u ms", op,
+		   stream_objs.crc, size, ms);
+	if (stream_objs.err_words != 0) {
+		shell_error(test_objs.shell, "%s: first mismatch at 0x%x, %u words differ", op,
+			    stream_objs.first_err, stream_objs.err_words);
+	}
+}
+
+static int nor_flash_stream_program(const struct device *flash_dev, off_t addr, size_t size,
+				    enum test_pattern_type type)
+{
+	struct test_pattern pat;
+	off_t write_addr = addr;
+	size_t temp_size = size;
+	size_t write_size;
+	int rc;
+
+	/* flash_write() returns once programmed, so fill and write share one buffer */
+	test_pattern_init(&pat, type, 0, addr);
+	while (temp_size) {
+		write_size = MIN(temp_size, STREAM_BUF_SIZE);
+		test_pattern_fill(&pat, stream_buf[0], write_size);
+
+		rc = flash_write(flash_dev, write_addr, stream_buf[0], write_size);
+		if (rc != 0) {
+			LOG_ERR("flash_write() failed: %d", rc);
+			return -ENODEV;
+		}
+
+		write_addr += write_size;
+		temp_size -= write_size;
+	}
+
+	return 0;
+}
+
+static int nor_flash_stream_write(const struct device *flash_dev, off_t addr, size_t size,
+				  enum test_pattern_type type)
+{
+	uint32_t start = k_cycle_get_32();
+	int rc;
+
+	shell_info(test_objs.shell, "Flash Address: 0x%lx, size: 0x%x, pattern: %s", addr, size,
+		   test_pattern_name(type));
+
+	rc = flash_erase(flash_dev, addr, size);
+	if (rc != 0) {
+		LOG_ERR("flash_erase() failed: %d", rc);
+		return -ENODEV;
+	}
+
+	/* Check if erase flash operation is successful or not? */
+	rc = nor_flash_stream_verify(flash_dev, addr, size, STREAM_EXPECT_ERASED, type);
+	nor_flash_stream_report("Erase check", size, k_cycle_get_32() - start);
+	if (rc != 0) {
+		return rc;
+	}
+
+	start = k_cycle_get_32();
+	rc = nor_flash_stream_program(flash_dev, addr, size, type);
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = nor_flash_stream_verify(flash_dev, addr, size, STREAM_EXPECT_PATTERN, type);
+	nor_flash_stream_report("Write check", size, k_cycle_get_32() - start);
+
+	return rc;
+}
 
 static int nor_flash_read_id_handler(const struct shell *shell, size_t argc, char **argv)
 {
@@ -746,6 +1148,159 @@ static int nor_flash_write_only_handler(const struct shell *shell, size_t argc,
 	return 0;
 }
 
+static int nor_flash_bench_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	char *eptr;
+	uint32_t addr;
+	uint32_t size;
+	uint32_t chunk;
+	int rc;
+
+	/* Convert integer from string */
+	addr = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+
+	size = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+
+	chunk = strtoul(argv[3], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[3]);
+		return -EINVAL;
+	}
+
+	if (size == 0 || chunk < BENCH_MIN_CHUNK_SIZE) {
+		shell_error(shell, "Invalid argument, size > 0 and chunk >= %d",
+			    BENCH_MIN_CHUNK_SIZE);
+		return -EINVAL;
+	}
+
+	if (chunk > BENCH_BUF_SIZE) {
+		shell_warn(shell, "Max chunk limited to bench buffer size %d", BENCH_BUF_SIZE);
+		chunk = BENCH_BUF_SIZE;
+	}
+
+	shell_info(shell, "Benchmark NOR FLASH");
+	/* Start to test */
+	test_objs.shell = shell;
+	for (int i = 0; i < NUM_FLASH_DEVICE; i++) {
+		rc = nor_flash_bench(flash_devices[i], addr, size, chunk);
+		if (rc != 0) {
+			return 0;
+		}
+	}
+
+	shell_info(shell, "[PASS] Flash bench succeeded!");
+	shell_info(shell, "[GO]");
+	return 0;
+}
+
+static int nor_flash_stream_args(const struct shell *shell, char **argv, uint32_t *addr,
+				 uint32_t *size)
+{
+	char *eptr;
+
+	/* Convert integer from string */
+	*addr = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+
+	*size = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+
+	if ((*addr % sizeof(uint32_t)) != 0 || (*size % sizeof(uint32_t)) != 0) {
+		shell_error(shell, "Invalid argument, addr and size must be word aligned");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int nor_flash_stream_write_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	enum test_pattern_type type = TEST_PATTERN_ADDR;
+	uint32_t addr;
+	uint32_t size;
+
+	if (nor_flash_stream_args(shell, argv, &addr, &size) != 0) {
+		return -EINVAL;
+	}
+
+	if (argc > 3) {
+		type = test_pattern_from_name(argv[3]);
+		if (type == TEST_PATTERN_NUM) {
+			shell_error(shell, "Invalid argument, '%s' is not a pattern", argv[3]);
+			return -EINVAL;
+		}
+	}
+
+	shell_info(shell, "Streaming write NOR FLASH");
+	/* Start to test */
+	test_objs.shell = shell;
+	if (nor_flash_stream_write(test_objs.cur_dev, addr, size, type) != 0) {
+		shell_error(shell, "[FAIL] Flash streaming write failed!");
+		return 0;
+	}
+
+	shell_info(shell, "[PASS] Flash streaming write succeeded!");
+	shell_info(shell, "[GO]");
+	return 0;
+}
+
+static int nor_flash_stream_verify_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	enum stream_expect expect = STREAM_EXPECT_NONE;
+	enum test_pattern_type type = TEST_PATTERN_ADDR;
+	uint32_t start;
+	uint32_t addr;
+	uint32_t size;
+	int rc;
+
+	if (nor_flash_stream_args(shell, argv, &addr, &size) != 0) {
+		return -EINVAL;
+	}
+
+	if (argc > 3) {
+		if (!strcmp("ff", argv[3])) {
+			expect = STREAM_EXPECT_ERASED;
+		} else {
+			expect = STREAM_EXPECT_PATTERN;
+			type = test_pattern_from_name(argv[3]);
+		}
+
+		if (type == TEST_PATTERN_NUM) {
+			shell_error(shell, "Invalid argument, '%s' is not ff or a pattern", argv[3]);
+			return -EINVAL;
+		}
+	}
+
+	shell_info(shell, "Streaming verify NOR FLASH");
+	/* Start to test */
+	test_objs.shell = shell;
+	start = k_cycle_get_32();
+	rc = nor_flash_stream_verify(test_objs.cur_dev, addr, size, expect, type);
+	nor_flash_stream_report("Verify", size, k_cycle_get_32() - start);
+	if (rc != 0) {
+		shell_error(shell, "[FAIL] Flash streaming verify failed!");
+		return 0;
+	}
+
+	shell_info(shell, "[PASS] Flash streaming verify succeeded!");
+	shell_info(shell, "[GO]");
+	return 0;
+}
+
 #ifdef CONFIG_FLASH_EX_OP_ENABLED
 static int nor_flash_read_sts_reg_handler(const struct shell *shell, size_t argc, char **argv)
 {
@@ -987,6 +1542,16 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_nor_flash,
 		nor_flash_write_handler, 3, 0),
 	SHELL_CMD_ARG(wr_only, NULL, "nor_flash wr_only <addr> <size>: write flash",
 		nor_flash_write_only_handler, 3, 0),
+	SHELL_CMD_ARG(bench, NULL, "nor_flash bench <addr> <size> <chunk>: flash throughput "
+		"of all devices, chunk size swept from 16 up to <chunk>",
+		nor_flash_bench_handler, 4, 0),
+	SHELL_CMD_ARG(swrite, NULL, "nor_flash swrite <addr> <size> [pattern]: erase, program "
+		"and verify flash with streaming buffers",
+		nor_flash_stream_write_handler, 3, 1),
+	SHELL_CMD_ARG(sverify, NULL, "nor_flash sverify <addr> <size> [ff/pattern]: crc32 of "
+		"flash, check erased or pattern data and report first mismatch, patterns are "
+		"by address so any sub-range of an swrite region can be checked",
+		nor_flash_stream_verify_handler, 3, 1),
 #ifdef CONFIG_FLASH_EX_OP_ENABLED
 	SHELL_CMD_ARG(rdst, NULL, "nor_flash rdst: read flash status registers",
 		nor_flash_read_sts_reg_handler, 1, 0),
@@ -11,8 +11,19 @@
 #include <zephyr/shell/shell.h>
 #include <zephyr/shell/shell_uart.h>
 #include <zephyr/crypto/crypto.h>
+#include <zephyr/drivers/flash.h>
 #include <zephyr/logging/log.h>
+#if defined(CONFIG_MBEDTLS_SHA256)
+#include <mbedtls/sha256.h>
+#endif
+#if defined(CONFIG_MBEDTLS_SHA384) || defined(CONFIG_MBEDTLS_SHA512)
+#include <mbedtls/sha512.h>
+#endif
+#if defined(CONFIG_SHA_TEST_VECTORS)
 #include "sha_data.h"
+#endif
+#include "test_pattern.h"
+#include "test_timing.h"
 
 LOG_MODULE_REGISTER(main);
 
@@ -45,6 +56,7 @@ const char *getSHA_Alg(enum hash_algo alg)
 	return "";
 }
 
+#if defined(CONFIG_SHA_TEST_VECTORS)
 static int hash_test(const struct shell *shell, uint8_t index,
 		      enum hash_algo sha, struct hash_ctx *ctx)
 {
@@ -84,6 +96,7 @@ static int hash_test(const struct shell *shell, uint8_t index,
 
 	return 0;
 }
+#endif /* CONFIG_SHA_TEST_VECTORS */
 
 static void sha_thread_entry(void *dummy1, void *dummy2, void *dummy3)
 {
@@ -112,6 +125,7 @@ static int sha_alg_mode(const struct shell *shell, size_t argc, char **argv)
 	return 0;
 }
 
+#if defined(CONFIG_SHA_TEST_VECTORS)
 static int sha_test(const struct shell *shell, size_t argc, char **argv)
 {
 	int ret, cnt;
@@ -149,6 +163,818 @@ static int sha_test(const struct shell *shell, size_t argc, char **argv)
 
 	return 0;
 }
+#endif /* CONFIG_SHA_TEST_VECTORS */
+
+struct sha_alg_info {
+	const char *name;
+	enum hash_algo alg;
+	uint32_t digest_sz;
+};
+
+static const struct sha_alg_info sha_algs[] = {
+	{ "sha256", CRYPTO_HASH_ALGO_SHA256, 32 },
+	{ "sha384", CRYPTO_HASH_ALGO_SHA384, 48 },
+	{ "sha512", CRYPTO_HASH_ALGO_SHA512, 64 },
+};
+
+static const struct sha_alg_info *sha_alg_from_name(const char *name)
+{
+	for (int i = 0; i < ARRAY_SIZE(sha_algs); i++) {
+		if (!strcmp(sha_algs[i].name, name)) {
+			return &sha_algs[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Messages longer than the bench buffer hash the buffer over and over,
+ * so sizes up to SHA_BENCH_MAX_SIZE need no more RAM than the buffer.
+ */
+#define SHA_BENCH_BUF_SIZE	KB(16)
+#define SHA_BENCH_MAX_SIZE	MB(1)
+/* Every size is hashed until at least this many bytes went through */
+#define SHA_BENCH_MIN_BYTES	KB(256)
+#define SHA_BENCH_SESSIONS	32
+
+static uint8_t sha_bench_buf[SHA_BENCH_BUF_SIZE] __aligned(4);
+
+static int sha_hw_hash(struct hash_ctx *ctx, size_t size, uint8_t *digest)
+{
+	struct hash_pkt pkt = {
+		.in_buf = sha_bench_buf,
+		.out_buf = digest,
+	};
+	int ret;
+
+	for (; size > SHA_BENCH_BUF_SIZE; size -= SHA_BENCH_BUF_SIZE) {
+		pkt.in_len = SHA_BENCH_BUF_SIZE;
+		ret = hash_update(ctx, &pkt);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+	pkt.in_len = size;
+
+	return hash_compute(ctx, &pkt);
+}
+
+#if defined(CONFIG_MBEDTLS_SHA256)
+static void sha_sw_sha256(size_t size, uint8_t *digest)
+{
+	mbedtls_sha256_context sha256;
+	size_t len;
+
+	mbedtls_sha256_init(&sha256);
+	mbedtls_sha256_starts(&sha256, 0);
+	for (; size > 0; size -= len) {
+		len = MIN(size, SHA_BENCH_BUF_SIZE);
+		mbedtls_sha256_update(&sha256, sha_bench_buf, len);
+	}
+	mbedtls_sha256_finish(&sha256, digest);
+	mbedtls_sha256_free(&sha256);
+}
+#endif
+
+#if defined(CONFIG_MBEDTLS_SHA384) || defined(CONFIG_MBEDTLS_SHA512)
+static void sha_sw_sha512(size_t size, bool is384, uint8_t *digest)
+{
+	mbedtls_sha512_context sha512;
+	size_t len;
+
+	mbedtls_sha512_init(&sha512);
+	mbedtls_sha512_starts(&sha512, is384);
+	for (; size > 0; size -= len) {
+		len = MIN(size, SHA_BENCH_BUF_SIZE);
+		mbedtls_sha512_update(&sha512, sha_bench_buf, len);
+	}
+	mbedtls_sha512_finish(&sha512, digest);
+	mbedtls_sha512_free(&sha512);
+}
+#endif
+
+/* Software baseline, -ENOTSUP when mbedTLS is built without the algorithm */
+static int sha_sw_hash(enum hash_algo alg, size_t size, uint8_t *digest)
+{
+	switch (alg) {
+#if defined(CONFIG_MBEDTLS_SHA256)
+	case CRYPTO_HASH_ALGO_SHA256:
+		sha_sw_sha256(size, digest);
+		return 0;
+#endif
+#if defined(CONFIG_MBEDTLS_SHA384)
+	case CRYPTO_HASH_ALGO_SHA384:
+		sha_sw_sha512(size, true, digest);
+		return 0;
+#endif
+#if defined(CONFIG_MBEDTLS_SHA512)
+	case CRYPTO_HASH_ALGO_SHA512:
+		sha_sw_sha512(size, false, digest);
+		return 0;
+#endif
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static void sha_bench_print(const struct shell *shell, uint64_t bytes, uint64_t cycles)
+{
+	uint32_t cpb = cycles * 100U / bytes;
+	uint32_t kbps = test_timing_kbps(bytes, cycles);
+
+	if (kbps == 0) {
+		shell_fprintf(shell, SHELL_NORMAL, " | %6u.%02u |     -.---", cpb / 100U,
+			      cpb % 100U);
+		return;
+	}
+
+	shell_fprintf(shell, SHELL_NORMAL, " | %6u.%02u | %5u.%03u", cpb / 100U, cpb % 100U,
+		      kbps / 1000U, kbps % 1000U);
+}
+
+static int sha_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	const struct sha_alg_info *info = sha_alg_from_name(argv[1]);
+	uint8_t hw_digest[64], sw_digest[64];
+	uint32_t min, max, size, loops, start, crossover = 0;
+	uint32_t begin_cycles = 0, free_cycles = 0, session;
+	uint64_t hw_cycles, sw_cycles;
+	struct test_pattern pat;
+	struct hash_ctx ctx;
+	int ret, sw_ret = 0;
+	char *eptr;
+
+	if (info == NULL) {
+		shell_error(shell, "Invalid argument, '%s' is not sha256/384/512", argv[1]);
+		return -EINVAL;
+	}
+
+	min = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+
+	max = strtoul(argv[3], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[3]);
+		return -EINVAL;
+	}
+
+	if (min == 0 || min > max || max > SHA_BENCH_MAX_SIZE) {
+		shell_error(shell, "Sizes must be 1 <= min <= max <= %u", SHA_BENCH_MAX_SIZE);
+		return -EINVAL;
+	}
+
+	test_pattern_init(&pat, TEST_PATTERN_LFSR, 0x5A5A, 0);
+	test_pattern_fill(&pat, sha_bench_buf, sizeof(sha_bench_buf));
+
+	ctx.flags = CAP_SYNC_OPS | CAP_SEPARATE_IO_BUFS;
+
+	for (int i = 0; i < SHA_BENCH_SESSIONS; i++) {
+		start = test_timing_cycles();
+		ret = hash_begin_session(sha_dev, &ctx, info->alg);
+		begin_cycles += test_timing_cycles() - start;
+		if (ret != 0) {
+			shell_error(shell, "[FAIL] Failed to init session");
+			return -EINVAL;
+		}
+
+		start = test_timing_cycles();
+		hash_free_session(sha_dev, &ctx);
+		free_cycles += test_timing_cycles() - start;
+	}
+	begin_cycles /= SHA_BENCH_SESSIONS;
+	free_cycles /= SHA_BENCH_SESSIONS;
+	session = begin_cycles + free_cycles;
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "%s bench in host cycles", info->name);
+#else
+	shell_print(shell, "%s bench in cycles (%u Hz)", info->name,
+		    sys_clock_hw_cycles_per_sec());
+#endif
+	shell_print(shell, "Session: begin %u, free %u cycles", begin_cycles, free_cycles);
+	shell_print(shell, "  %7s | %9s | %9s | %9s | %9s", "size", "hw cyc/B", "hw MB/s",
+		    "sw cyc/B", "sw MB/s");
+
+	ret = hash_begin_session(sha_dev, &ctx, info->alg);
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] Failed to init session");
+		return -EINVAL;
+	}
+
+	for (size = min; ; size = MIN(size * 2, max)) {
+		loops = MAX(1, SHA_BENCH_MIN_BYTES / size);
+
+		start = test_timing_cycles();
+		for (uint32_t i = 0; i < loops && ret == 0; i++) {
+			ret = sha_hw_hash(&ctx, size, hw_digest);
+		}
+		hw_cycles = test_timing_cycles() - start;
+		if (ret != 0) {
+			shell_error(shell, "[FAIL] Failed to compute hash of %u bytes", size);
+			break;
+		}
+
+		start = test_timing_cycles();
+		for (uint32_t i = 0; i < loops && sw_ret == 0; i++) {
+			sw_ret = sha_sw_hash(info->alg, size, sw_digest);
+		}
+		sw_cycles = test_timing_cycles() - start;
+
+		if (sw_ret == 0 && memcmp(hw_digest, sw_digest, info->digest_sz) != 0) {
+			shell_error(shell, "[FAIL] Digest of %u bytes differs from software", size);
+			ret = -EIO;
+			break;
+		}
+
+		shell_fprintf(shell, SHELL_NORMAL, "  %7u", size);
+		sha_bench_print(shell, (uint64_t)size * loops, hw_cycles);
+		if (sw_ret == 0) {
+			sha_bench_print(shell, (uint64_t)size * loops, sw_cycles);
+			/* One message per session, as when an image is hashed once at boot */
+			if (crossover == 0 && hw_cycles + (uint64_t)session * loops < sw_cycles) {
+				crossover = size;
+			}
+		}
+		shell_fprintf(shell, SHELL_NORMAL, "\n");
+
+		if (size == max) {
+			break;
+		}
+	}
+
+	hash_free_session(sha_dev, &ctx);
+	if (ret != 0) {
+		return -EIO;
+	}
+
+	if (sw_ret != 0) {
+		shell_print(shell, "No software baseline for %s", info->name);
+	} else if (crossover != 0) {
+		shell_print(shell, "Hardware with session setup is faster from %u bytes",
+			    crossover);
+	} else {
+		shell_print(shell, "Software is faster at every size");
+	}
+
+	shell_info(shell, "[PASS] SHA bench succeeded!");
+	shell_info(shell, "[GO]");
+
+	return 0;
+}
+
+#define FLASH_DEV0 DT_ALIAS(spi_flash0)
+#define FLASH_DEV1 DT_ALIAS(spi_flash1)
+#define FLASH_DEV2 DT_ALIAS(spi_flash2)
+
+static const struct device *const flash_devices[] = {
+#if DT_NODE_HAS_STATUS(FLASH_DEV0, okay)
+	DEVICE_DT_GET(FLASH_DEV0),
+#endif
+#if DT_NODE_HAS_STATUS(FLASH_DEV1, okay)
+	DEVICE_DT_GET(FLASH_DEV1),
+#endif
+#if DT_NODE_HAS_STATUS(FLASH_DEV2, okay)
+	DEVICE_DT_GET(FLASH_DEV2),
+#endif
+};
+
+/*
+ * Flash region hash. A reader thread fills one buffer while the caller
+ * hashes the other, free_sem counts empty buffers and full_sem filled ones.
+ */
+#define SHA_FLASH_CHUNK_MAX	KB(8)
+#define SHA_FLASH_STACK_SIZE	1024
+
+K_THREAD_STACK_DEFINE(sha_flash_stack, SHA_FLASH_STACK_SIZE);
+static struct k_thread sha_flash_thread;
+static K_SEM_DEFINE(sha_flash_free_sem, 0, 2);
+static K_SEM_DEFINE(sha_flash_full_sem, 0, 2);
+static uint8_t sha_flash_buf[2][SHA_FLASH_CHUNK_MAX] __aligned(4);
+
+struct sha_flash_job {
+	const struct device *dev;
+	uint32_t addr;
+	uint32_t size;
+	uint32_t chunk;
+	int ret;
+};
+
+static void sha_flash_reader(void *p1, void *p2, void *p3)
+{
+	struct sha_flash_job *job = p1;
+	uint32_t offs, len;
+	int i = 0;
+
+	for (offs = 0; offs < job->size; offs += len, i ^= 1) {
+		len = MIN(job->chunk, job->size - offs);
+		k_sem_take(&sha_flash_free_sem, K_FOREVER);
+		if (job->ret == 0) {
+			job->ret = flash_read(job->dev, job->addr + offs, sha_flash_buf[i], len);
+		}
+		k_sem_give(&sha_flash_full_sem);
+	}
+}
+
+/* Hash one chunk, the last one finishes the digest */
+static int sha_flash_hash(struct hash_ctx *ctx, uint8_t *buf, uint32_t len, bool last,
+			  uint8_t *digest)
+{
+	struct hash_pkt pkt = {
+		.in_buf = buf,
+		.in_len = len,
+		.out_buf = digest,
+	};
+
+	return last ? hash_compute(ctx, &pkt) : hash_update(ctx, &pkt);
+}
+
+static int sha_flash_serial(struct hash_ctx *ctx, struct sha_flash_job *job, bool hash,
+			    uint8_t *digest)
+{
+	uint32_t offs, len;
+	int ret = 0;
+
+	for (offs = 0; offs < job->size && ret == 0; offs += len) {
+		len = MIN(job->chunk, job->size - offs);
+		ret = flash_read(job->dev, job->addr + offs, sha_flash_buf[0], len);
+		if (ret == 0 && hash) {
+			ret = sha_flash_hash(ctx, sha_flash_buf[0], len,
+					     offs + len == job->size, digest);
+		}
+	}
+
+	return ret;
+}
+
+static int sha_flash_pipelined(struct hash_ctx *ctx, struct sha_flash_job *job, uint8_t *digest)
+{
+	uint32_t offs, len;
+	int ret = 0, i = 0;
+
+	job->ret = 0;
+	k_sem_reset(&sha_flash_free_sem);
+	k_sem_reset(&sha_flash_full_sem);
+	k_sem_give(&sha_flash_free_sem);
+	k_sem_give(&sha_flash_free_sem);
+	k_thread_create(&sha_flash_thread, sha_flash_stack, K_THREAD_STACK_SIZEOF(sha_flash_stack),
+			sha_flash_reader, job, NULL, NULL, THREAD_PRIORITY, 0, K_NO_WAIT);
+
+	/* Keep consuming after an error so the reader always runs to the end */
+	for (offs = 0; offs < job->size; offs += len, i ^= 1) {
+		len = MIN(job->chunk, job->size - offs);
+		k_sem_take(&sha_flash_full_sem, K_FOREVER);
+		if (ret == 0 && job->ret == 0) {
+			ret = sha_flash_hash(ctx, sha_flash_buf[i], len, offs + len == job->size,
+					     digest);
+		}
+		k_sem_give(&sha_flash_free_sem);
+	}
+	k_thread_join(&sha_flash_thread, K_FOREVER);
+
+	return ret ? ret : job->ret;
+}
+
+static void sha_flash_print(const struct shell *shell, const char *mode, uint32_t size,
+			    uint32_t cycles)
+{
+	uint32_t kbps = test_timing_kbps(size, cycles);
+
+	shell_print(shell, "  %-9s: %10u cycles, %u.%03u MB/s", mode, cycles, kbps / 1000U,
+		    kbps % 1000U);
+}
+
+static int sha_flash(const struct shell *shell, size_t argc, char **argv)
+{
+	const struct sha_alg_info *info = NULL;
+	struct sha_flash_job job = { .chunk = KB(4) };
+	uint8_t digest[64], ref_digest[64];
+	uint32_t dev, start, cycles[3];
+	struct hash_ctx ctx;
+	char *eptr;
+	int ret;
+
+	dev = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0' || dev >= ARRAY_SIZE(flash_devices)) {
+		shell_error(shell, "Invalid argument, device 0 - %d",
+			    (int)ARRAY_SIZE(flash_devices) - 1);
+		return -EINVAL;
+	}
+	job.dev = flash_devices[dev];
+
+	job.addr = strtoul(argv[2], &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[2]);
+		return -EINVAL;
+	}
+
+	job.size = strtoul(argv[3], &eptr, 0);
+	if (*eptr != '\0' || job.size == 0) {
+		shell_error(shell, "Invalid argument, '%s' is not a size", argv[3]);
+		return -EINVAL;
+	}
+
+	if (argc > 4) {
+		job.chunk = strtoul(argv[4], &eptr, 0);
+		if (*eptr != '\0' || job.chunk == 0 || job.chunk > SHA_FLASH_CHUNK_MAX) {
+			shell_error(shell, "Invalid argument, chunk 1 - %u", SHA_FLASH_CHUNK_MAX);
+			return -EINVAL;
+		}
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(sha_algs); i++) {
+		if (sha_algs[i].alg == g_sha) {
+			info = &sha_algs[i];
+		}
+	}
+
+	if (!device_is_ready(job.dev)) {
+		shell_error(shell, "%s is not ready", job.dev->name);
+		return -ENODEV;
+	}
+
+	ctx.flags = CAP_SYNC_OPS | CAP_SEPARATE_IO_BUFS;
+	ret = hash_begin_session(sha_dev, &ctx, g_sha);
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] Failed to init session");
+		return -EINVAL;
+	}
+
+	/* Read alone, then read and hash in turn, then overlapped */
+	start = test_timing_cycles();
+	ret = sha_flash_serial(&ctx, &job, false, NULL);
+	cycles[0] = test_timing_cycles() - start;
+
+	if (ret == 0) {
+		start = test_timing_cycles();
+		ret = sha_flash_serial(&ctx, &job, true, ref_digest);
+		cycles[1] = test_timing_cycles() - start;
+	}
+
+	if (ret == 0) {
+		start = test_timing_cycles();
+		ret = sha_flash_pipelined(&ctx, &job, digest);
+		cycles[2] = test_timing_cycles() - start;
+	}
+
+	hash_free_session(sha_dev, &ctx);
+
+	if (ret != 0) {
+		shell_error(shell, "[FAIL] Flash hash failed: %d", ret);
+		return -EIO;
+	}
+
+	if (memcmp(digest, ref_digest, info->digest_sz) != 0) {
+		shell_error(shell, "[FAIL] Pipelined digest differs from serial");
+		return -EIO;
+	}
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "%s %s 0x%x+0x%x in %u byte chunks, host cycles", info->name,
+		    job.dev->name, job.addr, job.size, job.chunk);
+#else
+	shell_print(shell, "%s %s 0x%x+0x%x in %u byte chunks, cycles (%u Hz)", info->name,
+		    job.dev->name, job.addr, job.size, job.chunk, sys_clock_hw_cycles_per_sec());
+#endif
+	sha_flash_print(shell, "read", job.size, cycles[0]);
+	sha_flash_print(shell, "serial", job.size, cycles[1]);
+	sha_flash_print(shell, "pipelined", job.size, cycles[2]);
+
+	shell_fprintf(shell, SHELL_NORMAL, "  digest   : ");
+	for (int i = 0; i < info->digest_sz; i++) {
+		shell_fprintf(shell, SHELL_NORMAL, "%02x", digest[i]);
+	}
+	shell_fprintf(shell, SHELL_NORMAL, "\n");
+
+	shell_info(shell, "[PASS] SHA flash succeeded!");
+	shell_info(shell, "[GO]");
+
+	return 0;
+}
+
+/*
+ * Known answer tests with the messages generated at run time: each one is a
+ * pattern repeated a number of times, fed in SHA_KAT_CHUNK byte pieces that
+ * do not line up with the block size. The vectors are the NIST examples
+ * plus a message of just over 1 MB, only their digests take ROM.
+ */
+#define SHA_KAT_CHUNK		1000
+/* SHAVS Monte Carlo test, iterations of each of the checkpoints */
+#define SHA_MCT_ROUNDS		100
+#define SHA_MCT_ITERATIONS	1000
+
+struct sha_kat_vec {
+	const char *pattern;
+	uint32_t repeat;
+	uint8_t sha256[32];
+	uint8_t sha384[48];
+	uint8_t sha512[64];
+};
+
+static const struct sha_kat_vec sha_kat_vecs[] = {
+	{
+		.pattern = "",
+		.repeat = 1,
+		.sha256 = {
+			0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8,
+			0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+			0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55,
+		},
+		.sha384 = {
+			0x38, 0xb0, 0x60, 0xa7, 0x51, 0xac, 0x96, 0x38, 0x4c, 0xd9, 0x32, 0x7e,
+			0xb1, 0xb1, 0xe3, 0x6a, 0x21, 0xfd, 0xb7, 0x11, 0x14, 0xbe, 0x07, 0x43,
+			0x4c, 0x0c, 0xc7, 0xbf, 0x63, 0xf6, 0xe1, 0xda, 0x27, 0x4e, 0xde, 0xbf,
+			0xe7, 0x6f, 0x65, 0xfb, 0xd5, 0x1a, 0xd2, 0xf1, 0x48, 0x98, 0xb9, 0x5b,
+		},
+		.sha512 = {
+			0xcf, 0x83, 0xe1, 0x35, 0x7e, 0xef, 0xb8, 0xbd, 0xf1, 0x54, 0x28, 0x50,
+			0xd6, 0x6d, 0x80, 0x07, 0xd6, 0x20, 0xe4, 0x05, 0x0b, 0x57, 0x15, 0xdc,
+			0x83, 0xf4, 0xa9, 0x21, 0xd3, 0x6c, 0xe9, 0xce, 0x47, 0xd0, 0xd1, 0x3c,
+			0x5d, 0x85, 0xf2, 0xb0, 0xff, 0x83, 0x18, 0xd2, 0x87, 0x7e, 0xec, 0x2f,
+			0x63, 0xb9, 0x31, 0xbd, 0x47, 0x41, 0x7a, 0x81, 0xa5, 0x38, 0x32, 0x7a,
+			0xf9, 0x27, 0xda, 0x3e,
+		},
+	},
+	{
+		.pattern = "abc",
+		.repeat = 1,
+		.sha256 = {
+			0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde,
+			0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+			0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+		},
+		.sha384 = {
+			0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b, 0xb5, 0xa0, 0x3d, 0x69,
+			0x9a, 0xc6, 0x50, 0x07, 0x27, 0x2c, 0x32, 0xab, 0x0e, 0xde, 0xd1, 0x63,
+			0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff, 0x5b, 0xed, 0x80, 0x86, 0x07, 0x2b,
+			0xa1, 0xe7, 0xcc, 0x23, 0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7,
+		},
+		.sha512 = {
+			0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41, 0x73, 0x49,
+			0xae, 0x20, 0x41, 0x31, 0x12, 0xe6, 0xfa, 0x4e, 0x89, 0xa9, 0x7e, 0xa2,
+			0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55, 0xd3, 0x9a, 0x21, 0x92, 0x99, 0x2a,
+			0x27, 0x4f, 0xc1, 0xa8, 0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd,
+			0x45, 0x4d, 0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f,
+			0xa5, 0x4c, 0xa4, 0x9f,
+		},
+	},
+	{
+		.pattern = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+		.repeat = 1,
+		.sha256 = {
+			0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93,
+			0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+			0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1,
+		},
+		.sha384 = {
+			0x33, 0x91, 0xfd, 0xdd, 0xfc, 0x8d, 0xc7, 0x39, 0x37, 0x07, 0xa6, 0x5b,
+			0x1b, 0x47, 0x09, 0x39, 0x7c, 0xf8, 0xb1, 0xd1, 0x62, 0xaf, 0x05, 0xab,
+			0xfe, 0x8f, 0x45, 0x0d, 0xe5, 0xf3, 0x6b, 0xc6, 0xb0, 0x45, 0x5a, 0x85,
+			0x20, 0xbc, 0x4e, 0x6f, 0x5f, 0xe9, 0x5b, 0x1f, 0xe3, 0xc8, 0x45, 0x2b,
+		},
+		.sha512 = {
+			0x20, 0x4a, 0x8f, 0xc6, 0xdd, 0xa8, 0x2f, 0x0a, 0x0c, 0xed, 0x7b, 0xeb,
+			0x8e, 0x08, 0xa4, 0x16, 0x57, 0xc1, 0x6e, 0xf4, 0x68, 0xb2, 0x28, 0xa8,
+			0x27, 0x9b, 0xe3, 0x31, 0xa7, 0x03, 0xc3, 0x35, 0x96, 0xfd, 0x15, 0xc1,
+			0x3b, 0x1b, 0x07, 0xf9, 0xaa, 0x1d, 0x3b, 0xea, 0x57, 0x78, 0x9c, 0xa0,
+			0x31, 0xad, 0x85, 0xc7, 0xa7, 0x1d, 0xd7, 0x03, 0x54, 0xec, 0x63, 0x12,
+			0x38, 0xca, 0x34, 0x45,
+		},
+	},
+	{
+		.pattern = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+			   "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+		.repeat = 1,
+		.sha256 = {
+			0xcf, 0x5b, 0x16, 0xa7, 0x78, 0xaf, 0x83, 0x80, 0x03, 0x6c, 0xe5, 0x9e,
+			0x7b, 0x04, 0x92, 0x37, 0x0b, 0x24, 0x9b, 0x11, 0xe8, 0xf0, 0x7a, 0x51,
+			0xaf, 0xac, 0x45, 0x03, 0x7a, 0xfe, 0xe9, 0xd1,
+		},
+		.sha384 = {
+			0x09, 0x33, 0x0c, 0x33, 0xf7, 0x11, 0x47, 0xe8, 0x3d, 0x19, 0x2f, 0xc7,
+			0x82, 0xcd, 0x1b, 0x47, 0x53, 0x11, 0x1b, 0x17, 0x3b, 0x3b, 0x05, 0xd2,
+			0x2f, 0xa0, 0x80, 0x86, 0xe3, 0xb0, 0xf7, 0x12, 0xfc, 0xc7, 0xc7, 0x1a,
+			0x55, 0x7e, 0x2d, 0xb9, 0x66, 0xc3, 0xe9, 0xfa, 0x91, 0x74, 0x60, 0x39,
+		},
+		.sha512 = {
+			0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda, 0x8c, 0xf4, 0xf7, 0x28,
+			0x14, 0xfc, 0x14, 0x3f, 0x8f, 0x77, 0x79, 0xc6, 0xeb, 0x9f, 0x7f, 0xa1,
+			0x72, 0x99, 0xae, 0xad, 0xb6, 0x88, 0x90, 0x18, 0x50, 0x1d, 0x28, 0x9e,
+			0x49, 0x00, 0xf7, 0xe4, 0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a,
+			0xc7, 0xd3, 0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54, 0x5e, 0x96, 0xe5, 0x5b,
+			0x87, 0x4b, 0xe9, 0x09,
+		},
+	},
+	{
+		.pattern = "a",
+		.repeat = 1000000,
+		.sha256 = {
+			0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7, 0xe2,
+			0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e,
+			0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0,
+		},
+		.sha384 = {
+			0x9d, 0x0e, 0x18, 0x09, 0x71, 0x64, 0x74, 0xcb, 0x08, 0x6e, 0x83, 0x4e,
+			0x31, 0x0a, 0x4a, 0x1c, 0xed, 0x14, 0x9e, 0x9c, 0x00, 0xf2, 0x48, 0x52,
+			0x79, 0x72, 0xce, 0xc5, 0x70, 0x4c, 0x2a, 0x5b, 0x07, 0xb8, 0xb3, 0xdc,
+			0x38, 0xec, 0xc4, 0xeb, 0xae, 0x97, 0xdd, 0xd8, 0x7f, 0x3d, 0x89, 0x85,
+		},
+		.sha512 = {
+			0xe7, 0x18, 0x48, 0x3d, 0x0c, 0xe7, 0x69, 0x64, 0x4e, 0x2e, 0x42, 0xc7,
+			0xbc, 0x15, 0xb4, 0x63, 0x8e, 0x1f, 0x98, 0xb1, 0x3b, 0x20, 0x44, 0x28,
+			0x56, 0x32, 0xa8, 0x03, 0xaf, 0xa9, 0x73, 0xeb, 0xde, 0x0f, 0xf2, 0x44,
+			0x87, 0x7e, 0xa6, 0x0a, 0x4c, 0xb0, 0x43, 0x2c, 0xe5, 0x77, 0xc3, 0x1b,
+			0xeb, 0x00, 0x9c, 0x5c, 0x2c, 0x49, 0xaa, 0x2e, 0x4e, 0xad, 0xb2, 0x17,
+			0xad, 0x8c, 0xc0, 0x9b,
+		},
+	},
+	{
+		.pattern = "01234567",
+		.repeat = 131073,
+		.sha256 = {
+			0x2e, 0x8b, 0xf9, 0x47, 0xf1, 0x23, 0xc3, 0x30, 0x59, 0x79, 0x7c, 0x32,
+			0x11, 0x0a, 0xfc, 0x2c, 0xb8, 0xab, 0xde, 0xd0, 0xc3, 0xdf, 0x36, 0xc3,
+			0x4f, 0x50, 0xa6, 0xd3, 0xf8, 0x0a, 0xc8, 0xf3,
+		},
+		.sha384 = {
+			0x98, 0x0c, 0x20, 0x55, 0x9b, 0xfe, 0x16, 0xfc, 0x92, 0x25, 0x84, 0x70,
+			0xab, 0x71, 0x61, 0xb3, 0x1c, 0xae, 0x1f, 0x21, 0xa3, 0xf6, 0x58, 0x85,
+			0x76, 0xc1, 0x4a, 0x81, 0xef, 0xe4, 0xd6, 0x44, 0xe1, 0x64, 0x12, 0x25,
+			0xae, 0x76, 0x13, 0x6d, 0x9f, 0xee, 0x6e, 0x04, 0x5f, 0xe0, 0x22, 0x99,
+		},
+		.sha512 = {
+			0x76, 0x9e, 0x3c, 0x81, 0x28, 0x18, 0x64, 0x12, 0x80, 0x38, 0xf2, 0x17,
+			0x2d, 0x44, 0x39, 0xe3, 0xff, 0x32, 0xab, 0x63, 0xc0, 0x34, 0xcf, 0xa4,
+			0x2f, 0x02, 0x14, 0x12, 0x1f, 0x2a, 0x66, 0x8a, 0xe8, 0x19, 0xe7, 0xe8,
+			0x2a, 0xa3, 0x28, 0xd2, 0x92, 0x68, 0x14, 0x5d, 0x68, 0xff, 0x58, 0x55,
+			0x6b, 0xe7, 0x45, 0xaf, 0xbc, 0xa6, 0xb6, 0x53, 0x81, 0xc0, 0xa5, 0x8d,
+			0xf8, 0x2b, 0x96, 0x7a,
+		},
+	},
+};
+
+/* Last checkpoint of the Monte Carlo test with seed 00 01 02 ... */
+static const struct sha_kat_vec sha_mct_result = {
+	.sha256 = {
+		0x71, 0x30, 0x00, 0x7f, 0xcf, 0xcc, 0xe9, 0xc2, 0x42, 0x77, 0x52, 0x19,
+		0xb6, 0x4b, 0x0a, 0x7d, 0xeb, 0xe0, 0x3c, 0x55, 0x3b, 0xf1, 0x65, 0xe0,
+		0xd7, 0x82, 0x01, 0x87, 0x15, 0x8c, 0xf1, 0x7d,
+	},
+	.sha384 = {
+		0x98, 0xfa, 0x01, 0xf3, 0xfb, 0xf3, 0xd3, 0xf1, 0x35, 0x78, 0xfa, 0x7c,
+		0xa0, 0xd4, 0xfd, 0x47, 0xfc, 0x58, 0xb1, 0x44, 0xc5, 0x49, 0x7b, 0x53,
+		0x27, 0x28, 0xa1, 0x00, 0x2d, 0x03, 0xa3, 0x93, 0x55, 0xd0, 0x9c, 0x12,
+		0xf1, 0x4e, 0x60, 0x8f, 0x74, 0x34, 0x82, 0x7d, 0x66, 0x50, 0xf1, 0x29,
+	},
+	.sha512 = {
+		0x8f, 0x9d, 0xc3, 0x56, 0xd6, 0x61, 0x49, 0x4f, 0x98, 0xb3, 0x53, 0x22,
+		0x6b, 0x62, 0x32, 0xc5, 0x25, 0x38, 0x2c, 0xfe, 0x6d, 0x24, 0x9a, 0x92,
+		0xe9, 0xd2, 0x56, 0x99, 0x6a, 0xfe, 0xb9, 0x70, 0xc9, 0xb6, 0x82, 0xee,
+		0xb6, 0xb9, 0x9c, 0x59, 0xd1, 0x46, 0xaa, 0x08, 0x01, 0x81, 0xcb, 0x76,
+		0x5f, 0x33, 0x16, 0x9f, 0x9c, 0x6d, 0xef, 0xdb, 0xde, 0x41, 0x6d, 0x66,
+		0x6e, 0x44, 0xe7, 0x7b,
+	},
+};
+
+static const uint8_t *sha_kat_digest(const struct sha_kat_vec *vec, enum hash_algo alg)
+{
+	switch (alg) {
+	case CRYPTO_HASH_ALGO_SHA384:
+		return vec->sha384;
+	case CRYPTO_HASH_ALGO_SHA512:
+		return vec->sha512;
+	default:
+		return vec->sha256;
+	}
+}
+
+/* Generate the message chunk by chunk, keeping the pattern phase across chunks */
+static int sha_kat_hash(struct hash_ctx *ctx, const struct sha_kat_vec *vec, uint8_t *digest)
+{
+	uint32_t plen = strlen(vec->pattern);
+	uint32_t total = plen * vec->repeat;
+	uint32_t pos = 0, len;
+	struct hash_pkt pkt = {
+		.in_buf = sha_bench_buf,
+		.out_buf = digest,
+	};
+	int ret;
+
+	do {
+		len = MIN(SHA_KAT_CHUNK, total - pos);
+		for (uint32_t i = 0; i < len; i++) {
+			sha_bench_buf[i] = vec->pattern[(pos + i) % plen];
+		}
+		pos += len;
+		pkt.in_len = len;
+		ret = pos == total ? hash_compute(ctx, &pkt) : hash_update(ctx, &pkt);
+	} while (ret == 0 && pos < total);
+
+	return ret;
+}
+
+/*
+ * Every message is the last three digests, so one wrong digest spoils all the
+ * following ones. 100000 back to back hash_compute calls in one session.
+ */
+static int sha_kat_mct(struct hash_ctx *ctx, uint32_t digest_sz, uint8_t *seed)
+{
+	uint8_t md[3 * 64], out[64];
+	struct hash_pkt pkt = {
+		.in_buf = md,
+		.in_len = 3 * digest_sz,
+		.out_buf = out,
+	};
+	int ret;
+
+	for (uint32_t i = 0; i < digest_sz; i++) {
+		seed[i] = i;
+	}
+
+	for (int j = 0; j < SHA_MCT_ROUNDS; j++) {
+		for (int k = 0; k < 3; k++) {
+			memcpy(&md[k * digest_sz], seed, digest_sz);
+		}
+		for (int i = 0; i < SHA_MCT_ITERATIONS; i++) {
+			ret = hash_compute(ctx, &pkt);
+			if (ret != 0) {
+				return ret;
+			}
+			memmove(md, &md[digest_sz], 2 * digest_sz);
+			memcpy(&md[2 * digest_sz], out, digest_sz);
+		}
+		memcpy(seed, out, digest_sz);
+	}
+
+	return 0;
+}
+
+static int sha_kat(const struct shell *shell, size_t argc, char **argv)
+{
+	const struct sha_alg_info *info;
+	uint32_t loops = 1, start, cycles;
+	uint8_t digest[64];
+	struct hash_ctx ctx;
+	char *eptr;
+	int ret;
+
+	if (argc > 1) {
+		loops = strtoul(argv[1], &eptr, 0);
+		if (*eptr != '\0' || loops == 0) {
+			shell_error(shell, "Invalid argument, '%s' is not a loop count", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	for (int a = 0; a < ARRAY_SIZE(sha_algs); a++) {
+		info = &sha_algs[a];
+		ctx.flags = CAP_SYNC_OPS | CAP_SEPARATE_IO_BUFS;
+		ret = hash_begin_session(sha_dev, &ctx, info->alg);
+		if (ret != 0) {
+			shell_error(shell, "[FAIL] Failed to init %s session", info->name);
+			return -EINVAL;
+		}
+
+		for (int i = 0; i < ARRAY_SIZE(sha_kat_vecs); i++) {
+			ret = sha_kat_hash(&ctx, &sha_kat_vecs[i], digest);
+			if (ret != 0 || memcmp(digest, sha_kat_digest(&sha_kat_vecs[i], info->alg),
+					       info->digest_sz) != 0) {
+				shell_error(shell, "[FAIL] %s \"%.8s\" x %u: %d", info->name,
+					    sha_kat_vecs[i].pattern, sha_kat_vecs[i].repeat, ret);
+				hash_free_session(sha_dev, &ctx);
+				return -EIO;
+			}
+		}
+		shell_print(shell, "%s: %d vectors passed", info->name,
+			    (int)ARRAY_SIZE(sha_kat_vecs));
+
+		/* Repeated, the Monte Carlo test doubles as a stress test */
+		for (uint32_t n = 0; n < loops; n++) {
+			start = test_timing_cycles();
+			ret = sha_kat_mct(&ctx, info->digest_sz, digest);
+			cycles = test_timing_cycles() - start;
+			if (ret != 0 || memcmp(digest, sha_kat_digest(&sha_mct_result, info->alg),
+					       info->digest_sz) != 0) {
+				shell_error(shell, "[FAIL] %s Monte Carlo loop %u: %d", info->name,
+					    n, ret);
+				hash_free_session(sha_dev, &ctx);
+				return -EIO;
+			}
+		}
+		shell_print(shell, "%s: Monte Carlo passed %u times, last in %u cycles", info->name,
+			    loops, cycles);
+
+		hash_free_session(sha_dev, &ctx);
+	}
+
+	shell_info(shell, "[PASS] SHA KAT succeeded!");
+	shell_info(shell, "[GO]");
+
+	return 0;
+}
 
 /* Main entry */
 int main(void)
@@ -164,7 +990,15 @@ int main(void)
 
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_sha,
 	SHELL_CMD_ARG(set_alg, NULL, "sha set_alg", sha_alg_mode, 2, 0),
+#if defined(CONFIG_SHA_TEST_VECTORS)
 	SHELL_CMD_ARG(sha_test, NULL, "sha sha_test", sha_test, 2, 0),
+#endif
+	SHELL_CMD_ARG(bench, NULL, "sha bench <sha256/384/512> <min> <max>: throughput",
+		sha_bench, 4, 0),
+	SHELL_CMD_ARG(flash, NULL, "sha flash <dev> <addr> <size> [chunk]: hash a flash region",
+		sha_flash, 4, 1),
+	SHELL_CMD_ARG(kat, NULL, "sha kat [mct loops]: generated known answer tests",
+		sha_kat, 1, 1),
 	SHELL_SUBCMD_SET_END /* Array terminated. */
 );
 SHELL_CMD_REGISTER(sha, &sub_sha, "SHA validation commands", NULL);
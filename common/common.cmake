@@ -0,0 +1,8 @@
+# SPDX-License-Identifier: Apache-2.0
+
+# Helpers shared by the validation apps, include() it after project()
+target_include_directories(app PRIVATE ${CMAKE_CURRENT_LIST_DIR}/include)
+target_sources(app PRIVATE ${CMAKE_CURRENT_LIST_DIR}/src/test_pattern.c)
+target_sources(app PRIVATE ${CMAKE_CURRENT_LIST_DIR}/src/test_hist.c)
+target_sources_ifdef(CONFIG_ESPI app PRIVATE ${CMAKE_CURRENT_LIST_DIR}/src/host_trace.c)
+target_sources_ifdef(CONFIG_ESPI app PRIVATE ${CMAKE_CURRENT_LIST_DIR}/src/espi_trace.c)
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ESPI_TRACE_H__
+#define __ESPI_TRACE_H__
+
+#include <stdint.h>
+#include <zephyr/drivers/espi.h>
+#include <zephyr/sys/atomic.h>
+
+/*
+ * Binary trace of eSPI events for the notification path instead of logging.
+ * Records are reserved with a CAS on the head, so any number of handlers may
+ * write concurrently from any context. A record is only visible to the
+ * reader once its tag is written. When the ring is full new records are
+ * dropped and counted as overflow. "espi_trace show" decodes and drains it.
+ */
+enum espi_trace_type {
+	ESPI_TRACE_RESET,	/* details: -, data: reset level */
+	ESPI_TRACE_CHANNEL,	/* details: enum espi_channel, data: ready */
+	ESPI_TRACE_VW,		/* details: received signal, data: level */
+	ESPI_TRACE_VW_OUT,	/* details: sent signal, data: level */
+	ESPI_TRACE_OOB,		/* details and data as in the OOB event */
+	ESPI_TRACE_PERIPH,	/* details and data as in the peripheral event */
+	ESPI_TRACE_TAF,		/* details and data as in the TAF event */
+	ESPI_TRACE_TYPE_NUM,
+};
+
+/* 16 bytes on 32-bit targets, tag holds the type and the low sequence bits */
+struct espi_trace_rec {
+	atomic_t tag;
+	uint32_t cycles;
+	uint32_t details;
+	uint32_t data;
+};
+
+void espi_trace_record(enum espi_trace_type type, uint32_t details, uint32_t data);
+
+/* Record a callback event, typed from its evt_type */
+void espi_trace_event(struct espi_event event);
+
+#endif /* __ESPI_TRACE_H__ */
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __HOST_TRACE_H__
+#define __HOST_TRACE_H__
+
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/espi.h>
+#include "test_hist.h"
+
+/*
+ * Scripted eSPI host. A trace of host events is replayed into the eSPI
+ * callbacks of the app, so the EC side handlers can be loaded without a PCH.
+ * With CONFIG_ESPI_EMUL virtual wires and port 80 writes go through the
+ * emulator, everything else is delivered straight to the callbacks the app
+ * passed to host_trace_init() the same way the driver dispatches them.
+ */
+enum host_trace_type {
+	HOST_TRACE_VW,		/* data: signal, op: level */
+	HOST_TRACE_P80,		/* data: first code, len: codes in the burst */
+	HOST_TRACE_KBC,		/* data: byte, op: 1 for command, len: repeat */
+	HOST_TRACE_ACPI,	/* data: byte, op: 1 for command, len: repeat */
+	HOST_TRACE_FLASH,	/* data: address, op: host_trace_flash_op, len: size/erase code */
+	HOST_TRACE_DELAY,	/* data: idle time in us */
+	HOST_TRACE_TYPE_NUM,
+};
+
+enum host_trace_flash_op {
+	HOST_TRACE_FLASH_READ,
+	HOST_TRACE_FLASH_WRITE,
+	HOST_TRACE_FLASH_ERASE,
+};
+
+struct host_trace_ev {
+	uint8_t type;
+	uint8_t op;
+	uint16_t len;
+	uint32_t data;
+};
+
+#define HOST_TRACE_EV(_type, _op, _len, _data)	\
+	{ .type = (_type), .op = (_op), .len = (_len), .data = (_data) }
+
+struct host_trace_stat {
+	uint32_t events[HOST_TRACE_TYPE_NUM];
+	/* Events no registered callback (or the emulator) accepted */
+	uint32_t unhandled;
+	uint32_t elapsed_us;
+	/* Cycles spent delivering one event, handlers included */
+	struct test_hist lat;
+};
+
+/* Register the callbacks events are delivered to, cbs must stay valid */
+void host_trace_init(const struct device *dev, struct espi_callback *const *cbs, size_t num);
+
+/* Deliver one event to the registered callbacks, false if none took it */
+bool host_trace_event(struct espi_event event);
+
+/*
+ * Replay num events loops times. rate is in events per second, 0 replays
+ * back to back. Delay events are honoured at any rate. Flash events are
+ * delivered from the calling thread, the TAF app tells them from the driver
+ * notifications and serves them without a completion on the bus.
+ */
+int host_trace_play(const struct host_trace_ev *trace, size_t num, uint32_t loops,
+		    uint32_t rate, struct host_trace_stat *stat);
+
+#endif /* __HOST_TRACE_H__ */
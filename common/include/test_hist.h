@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __TEST_HIST_H__
+#define __TEST_HIST_H__
+
+#include <stdint.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+
+/* Bin n counts values in [2^(n-1), 2^n - 1], bin 0 counts zero */
+#define TEST_HIST_BINS		33
+
+/*
+ * Fixed log2 histogram. Adding a sample only uses atomic operations, so it
+ * may be called from an ISR concurrently with other contexts and never
+ * allocates or locks.
+ */
+struct test_hist {
+	atomic_t bins[TEST_HIST_BINS];
+	atomic_t count;
+	atomic_t max;
+};
+
+void test_hist_reset(struct test_hist *hist);
+
+void test_hist_add(struct test_hist *hist, uint32_t val);
+
+static inline uint32_t test_hist_count(const struct test_hist *hist)
+{
+	return (uint32_t)atomic_get(&hist->count);
+}
+
+static inline uint32_t test_hist_max(const struct test_hist *hist)
+{
+	return (uint32_t)atomic_get(&hist->max);
+}
+
+/* Return the upper bound of the bin holding the pct-th percentile, capped at max */
+uint32_t test_hist_percentile(const struct test_hist *hist, uint32_t pct);
+
+/* Print the non-empty bins, one line each */
+void test_hist_print(const struct shell *shell, const struct test_hist *hist);
+
+#endif /* __TEST_HIST_H__ */
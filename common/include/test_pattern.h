@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __TEST_PATTERN_H__
+#define __TEST_PATTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum test_pattern_type {
+	TEST_PATTERN_ADDR,	/* address-seeded hash of each word address */
+	TEST_PATTERN_LFSR,	/* 32-bit Galois LFSR stream */
+	TEST_PATTERN_WALK1,	/* walking ones, one bit per word */
+	TEST_PATTERN_CHECKER,	/* 0x55555555/0xAAAAAAAA checkerboard */
+	TEST_PATTERN_NUM,
+};
+
+/*
+ * Generator state, one word wide. The word for an address is produced on the
+ * fly so a region of any size can be filled or verified with O(1) RAM. Fill
+ * and verify advance the state, so a region can be processed in chunks. The
+ * LFSR stream starts at address 0 and init seeks it to addr in O(log addr)
+ * steps, so any sub-range of a region verifies against the same seed.
+ */
+struct test_pattern {
+	enum test_pattern_type type;
+	uint32_t seed;
+	uint32_t addr;
+	uint32_t lfsr;
+};
+
+void test_pattern_init(struct test_pattern *pat, enum test_pattern_type type,
+		       uint32_t seed, uint32_t addr);
+
+void test_pattern_fill(struct test_pattern *pat, void *buf, size_t len);
+
+/* Return number of mismatched words, and the address of the first one in err_addr */
+uint32_t test_pattern_verify(struct test_pattern *pat, const void *buf, size_t len,
+			     uint32_t *err_addr);
+
+const char *test_pattern_name(enum test_pattern_type type);
+
+/* Return pattern type from its name, or TEST_PATTERN_NUM if unknown */
+enum test_pattern_type test_pattern_from_name(const char *name);
+
+#endif /* __TEST_PATTERN_H__ */
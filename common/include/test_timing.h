@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __TEST_TIMING_H__
+#define __TEST_TIMING_H__
+
+#include <zephyr/kernel.h>
+
+/*
+ * k_cycle_get_32 does not advance while native_sim executes code, so the
+ * benchmarks use the host time stamp counter there. Those cycles can only be
+ * compared with each other, they do not convert to time.
+ */
+#if defined(CONFIG_ARCH_POSIX) && (defined(__i386__) || defined(__x86_64__))
+#define TEST_TIMING_HOST_TSC 1
+#endif
+
+static inline uint32_t test_timing_cycles(void)
+{
+#ifdef TEST_TIMING_HOST_TSC
+	return (uint32_t)__builtin_ia32_rdtsc();
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+/* Return KB/s for bytes moved in cycles, 0 if unknown */
+static inline uint32_t test_timing_kbps(uint64_t bytes, uint64_t cycles)
+{
+#ifdef TEST_TIMING_HOST_TSC
+	return 0;
+#else
+	uint64_t us = k_cyc_to_us_floor64(cycles);
+
+	return (us == 0) ? 0 : (uint32_t)((bytes * 1000U) / us);
+#endif
+}
+
+/* Return events per second for count events in cycles, 0 if unknown */
+static inline uint32_t test_timing_rate(uint64_t count, uint64_t cycles)
+{
+#ifdef TEST_TIMING_HOST_TSC
+	return 0;
+#else
+	return (cycles == 0) ? 0 : (uint32_t)(count * sys_clock_hw_cycles_per_sec() / cycles);
+#endif
+}
+
+#endif /* __TEST_TIMING_H__ */
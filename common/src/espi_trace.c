@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include "espi_trace.h"
+#include "test_timing.h"
+
+#define ESPI_TRACE_SIZE		256
+#define ESPI_TRACE_SEQ_MASK	0xFFFFFFU
+
+BUILD_ASSERT((ESPI_TRACE_SIZE & (ESPI_TRACE_SIZE - 1)) == 0, "ESPI_TRACE_SIZE not a power of 2");
+
+static struct espi_trace_rec trace_ring[ESPI_TRACE_SIZE];
+static atomic_t trace_head;
+static atomic_t trace_tail;
+static atomic_t trace_overflow;
+
+static inline uint32_t espi_trace_tag(uint32_t seq, enum espi_trace_type type)
+{
+	return ((seq & ESPI_TRACE_SEQ_MASK) << 8) | type;
+}
+
+void espi_trace_record(enum espi_trace_type type, uint32_t details, uint32_t data)
+{
+	uint32_t cycles = test_timing_cycles();
+	struct espi_trace_rec *rec;
+	atomic_val_t head;
+
+	do {
+		head = atomic_get(&trace_head);
+		if ((uint32_t)head - (uint32_t)atomic_get(&trace_tail) >= ESPI_TRACE_SIZE) {
+			atomic_inc(&trace_overflow);
+			return;
+		}
+	} while (!atomic_cas(&trace_head, head, head + 1));
+
+	rec = &trace_ring[(uint32_t)head % ESPI_TRACE_SIZE];
+	rec->cycles = cycles;
+	rec->details = details;
+	rec->data = data;
+	/* Publish last, the reader skips a slot until its tag matches */
+	atomic_set(&rec->tag, espi_trace_tag(head, type));
+}
+
+void espi_trace_event(struct espi_event event)
+{
+	enum espi_trace_type type;
+
+	switch (event.evt_type) {
+	case ESPI_BUS_RESET:
+		type = ESPI_TRACE_RESET;
+		break;
+	case ESPI_BUS_EVENT_CHANNEL_READY:
+		type = ESPI_TRACE_CHANNEL;
+		break;
+	case ESPI_BUS_EVENT_VWIRE_RECEIVED:
+		type = ESPI_TRACE_VW;
+		break;
+	case ESPI_BUS_EVENT_OOB_RECEIVED:
+		type = ESPI_TRACE_OOB;
+		break;
+	case ESPI_BUS_PERIPHERAL_NOTIFICATION:
+		type = ESPI_TRACE_PERIPH;
+		break;
+	default:
+		type = ESPI_TRACE_TAF;
+		break;
+	}
+
+	espi_trace_record(type, event.evt_details, event.evt_data);
+}
+
+#ifdef CONFIG_SHELL
+static const char *espi_trace_channel(uint32_t ch)
+{
+	switch (ch) {
+	case ESPI_CHANNEL_PERIPHERAL:
+		return "periph";
+	case ESPI_CHANNEL_VWIRE:
+		return "vw";
+	case ESPI_CHANNEL_OOB:
+		return "oob";
+	case ESPI_CHANNEL_FLASH:
+		return "flash";
+	default:
+		return "?";
+	}
+}
+
+/* Same decoding the handlers used to log */
+static void espi_trace_decode(enum espi_trace_type type, uint32_t details, uint32_t data,
+			      char *buf, size_t len)
+{
+	uint32_t kbc_evt = (data >> 16) & 0xFF;
+
+	switch (type) {
+	case ESPI_TRACE_RESET:
+		snprintk(buf, len, "bus reset %u", data);
+		break;
+	case ESPI_TRACE_CHANNEL:
+		snprintk(buf, len, "%s channel %s", espi_trace_channel(details),
+			 data ? "ready" : "off");
+		break;
+	case ESPI_TRACE_VW:
+		snprintk(buf, len, "vw in  signal %u level %u", details, data);
+		break;
+	case ESPI_TRACE_VW_OUT:
+		snprintk(buf, len, "vw out signal %u level %u", details, data);
+		break;
+	case ESPI_TRACE_OOB:
+		snprintk(buf, len, "oob %x [%x]", details, data);
+		break;
+	case ESPI_TRACE_PERIPH:
+		switch (details & 0xFFFF) {
+		case ESPI_PERIPHERAL_DEBUG_PORT80:
+			snprintk(buf, len, "p80 0x%02x", data);
+			break;
+		case ESPI_PERIPHERAL_8042_KBC:
+			snprintk(buf, len, "kbc%s%s %02x from %s",
+				 (kbc_evt & HOST_KBC_EVT_IBF) ? " IBF" : "",
+				 (kbc_evt & HOST_KBC_EVT_OBE) ? " OBE" : "", (data >> 8) & 0xFF,
+				 (data & 0x1) ? "COMMAND" : "DBBIN");
+			break;
+		case ESPI_PERIPHERAL_HOST_IO:
+			snprintk(buf, len, "acpi %02x from %s", (data >> 8) & 0xFF,
+				 (data & 0x1) ? "COMMAND" : "DBBIN");
+			break;
+		case ESPI_PERIPHERAL_EC_HOST_CMD:
+			snprintk(buf, len, "hcmd %x", data);
+			break;
+		default:
+			snprintk(buf, len, "periph 0x%x [%x]", details, data);
+			break;
+		}
+		break;
+	default:
+		snprintk(buf, len, "taf %x [%x]", details, data);
+		break;
+	}
+}
+
+static int espi_trace_show_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t tail = atomic_get(&trace_tail);
+	uint32_t lines = UINT32_MAX, count = 0, last = 0, tag;
+	uint32_t cycles, details, data;
+	struct espi_trace_rec *rec;
+	char text[64];
+	char *eptr;
+
+	if (argc > 1) {
+		lines = strtoul(argv[1], &eptr, 0);
+		if (*eptr != '\0') {
+			shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "eSPI trace, time in host cycles");
+#else
+	shell_print(shell, "eSPI trace, time in cycles (%u Hz)", sys_clock_hw_cycles_per_sec());
+#endif
+	for (; tail != (uint32_t)atomic_get(&trace_head); tail++, count++) {
+		rec = &trace_ring[tail % ESPI_TRACE_SIZE];
+		tag = atomic_get(&rec->tag);
+		/* Reserved but not written yet, stop here and leave it */
+		if ((tag >> 8) != (tail & ESPI_TRACE_SEQ_MASK)) {
+			break;
+		}
+		cycles = rec->cycles;
+		details = rec->details;
+		data = rec->data;
+		atomic_set(&trace_tail, tail + 1);
+
+		if (count < lines) {
+			espi_trace_decode(tag & 0xFF, details, data, text, sizeof(text));
+			shell_print(shell, "  %10u %+11d  %s", cycles,
+				    count ? (int32_t)(cycles - last) : 0, text);
+		}
+		last = cycles;
+	}
+
+	shell_print(shell, "%u records, %u overflow", count,
+		    (uint32_t)atomic_set(&trace_overflow, 0));
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_espi_trace,
+	SHELL_CMD_ARG(show, NULL, "espi_trace show [lines]: decode and drain the event trace",
+		espi_trace_show_handler, 1, 1),
+	SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+SHELL_CMD_REGISTER(espi_trace, &sub_espi_trace, "eSPI event trace commands", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/drivers/espi.h>
+#if defined(CONFIG_ESPI_SAF)
+#include <zephyr/drivers/espi_saf.h>
+#endif
+#ifdef CONFIG_ESPI_EMUL
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/espi_emul.h>
+#endif
+#include "host_trace.h"
+#include "test_pattern.h"
+#include "test_timing.h"
+
+/* eSPI tags are 4 bits wide */
+#define HOST_TRACE_TAG_NUM	16
+
+static const struct device *trace_dev;
+static struct espi_callback *const *trace_cbs;
+static size_t trace_cb_num;
+
+#ifdef CONFIG_ESPI_EMUL
+static const struct emul *const host_emul = EMUL_DT_GET(DT_NODELABEL(espi_host));
+#endif
+
+void host_trace_init(const struct device *dev, struct espi_callback *const *cbs, size_t num)
+{
+	trace_dev = dev;
+	trace_cbs = cbs;
+	trace_cb_num = num;
+}
+
+/* Same dispatch as the drivers, every callback registered for the event type */
+bool host_trace_event(struct espi_event event)
+{
+	bool handled = false;
+
+	for (size_t i = 0; i < trace_cb_num; i++) {
+		if (trace_cbs[i]->evt_type & event.evt_type) {
+			trace_cbs[i]->handler(trace_dev, trace_cbs[i], event);
+			handled = true;
+		}
+	}
+
+	return handled;
+}
+
+#if defined(CONFIG_ESPI_SAF)
+static bool host_trace_flash(const struct host_trace_ev *ev, uint32_t seq)
+{
+	static const uint8_t taf_type[] = {
+		[HOST_TRACE_FLASH_READ] = NPCX_ESPI_TAF_REQ_READ,
+		[HOST_TRACE_FLASH_WRITE] = NPCX_ESPI_TAF_REQ_WRITE,
+		[HOST_TRACE_FLASH_ERASE] = NPCX_ESPI_TAF_REQ_ERASE,
+	};
+	struct espi_taf_pckt pckt = {
+		.tag = seq % HOST_TRACE_TAG_NUM,
+		.addr = ev->data,
+		.len = ev->len,
+	};
+	struct espi_event event = {
+		.evt_type = ESPI_BUS_SAF_NOTIFICATION,
+		.evt_details = ESPI_CHANNEL_FLASH,
+		.evt_data = (uint32_t)&pckt,
+	};
+	struct test_pattern pat;
+
+	if (ev->op >= ARRAY_SIZE(taf_type)) {
+		return false;
+	}
+
+	pckt.type = taf_type[ev->op];
+	if (ev->op == HOST_TRACE_FLASH_WRITE) {
+		test_pattern_init(&pat, TEST_PATTERN_ADDR, 0, ev->data);
+		test_pattern_fill(&pat, pckt.src, sizeof(pckt.src));
+	}
+
+	/* The handler copies the request before returning, as with the driver */
+	return host_trace_event(event);
+}
+#else
+static bool host_trace_flash(const struct host_trace_ev *ev, uint32_t seq)
+{
+	/* Host initiated flash requests only exist with TAF */
+	return false;
+}
+#endif
+
+/* Deliver element idx of a burst, return false if nobody took it */
+static bool host_trace_send(const struct host_trace_ev *ev, uint32_t idx, uint32_t seq)
+{
+	struct espi_event event = {
+		.evt_type = ESPI_BUS_PERIPHERAL_NOTIFICATION,
+	};
+
+	switch (ev->type) {
+	case HOST_TRACE_VW:
+#ifdef CONFIG_ESPI_EMUL
+		return emul_espi_host_set_vw(host_emul, ev->data, ev->op) == 0;
+#else
+		event.evt_type = ESPI_BUS_EVENT_VWIRE_RECEIVED;
+		event.evt_details = ev->data;
+		event.evt_data = ev->op;
+		break;
+#endif
+	case HOST_TRACE_P80:
+#ifdef CONFIG_ESPI_EMUL
+		return emul_espi_host_port80_write(host_emul, ev->data + idx) == 0;
+#else
+		event.evt_details = ESPI_PERIPHERAL_DEBUG_PORT80;
+		event.evt_data = ev->data + idx;
+		break;
+#endif
+	case HOST_TRACE_KBC:
+		/* Same layout as struct espi_evt_data_kbc: type, data, evt */
+		event.evt_details = ESPI_PERIPHERAL_8042_KBC;
+		event.evt_data = (HOST_KBC_EVT_IBF << 16) | ((ev->data & 0xFF) << 8) | ev->op;
+		break;
+	case HOST_TRACE_ACPI:
+		event.evt_details = ESPI_PERIPHERAL_HOST_IO;
+		event.evt_data = ((ev->data & 0xFF) << 8) | ev->op;
+		break;
+	case HOST_TRACE_FLASH:
+		return host_trace_flash(ev, seq);
+	default:
+		return false;
+	}
+
+	return host_trace_event(event);
+}
+
+static void host_trace_delay(uint32_t us)
+{
+	if (us >= USEC_PER_MSEC) {
+		k_usleep(us);
+	} else if (us) {
+		k_busy_wait(us);
+	}
+}
+
+int host_trace_play(const struct host_trace_ev *trace, size_t num, uint32_t loops,
+		    uint32_t rate, struct host_trace_stat *stat)
+{
+	uint32_t period = rate ? sys_clock_hw_cycles_per_sec() / rate : 0;
+	uint32_t begin, deadline, start, now, burst;
+	const struct host_trace_ev *ev;
+	uint32_t seq = 0;
+
+	if (trace_dev == NULL) {
+		return -ENODEV;
+	}
+
+	memset(stat, 0, sizeof(*stat));
+	test_hist_reset(&stat->lat);
+
+	begin = k_cycle_get_32();
+	deadline = begin;
+	for (uint32_t loop = 0; loop < loops; loop++) {
+		for (size_t i = 0; i < num; i++) {
+			ev = &trace[i];
+			if (ev->type == HOST_TRACE_DELAY) {
+				host_trace_delay(ev->data);
+				deadline = k_cycle_get_32();
+				continue;
+			}
+
+			burst = (ev->type == HOST_TRACE_FLASH) ? 1 : MAX(ev->len, 1);
+			for (uint32_t idx = 0; idx < burst; idx++, seq++) {
+				/* Pace against a deadline so handler time is not added per event */
+				if (period) {
+					now = k_cycle_get_32();
+					if ((int32_t)(deadline - now) > 0) {
+						k_busy_wait(k_cyc_to_us_ceil32(deadline - now));
+					}
+					deadline += period;
+				}
+
+				start = test_timing_cycles();
+				if (!host_trace_send(ev, idx, seq)) {
+					stat->unhandled++;
+				}
+				test_hist_add(&stat->lat, test_timing_cycles() - start);
+				stat->events[ev->type]++;
+			}
+		}
+	}
+	stat->elapsed_us = k_cyc_to_us_floor32(k_cycle_get_32() - begin);
+
+	return 0;
+}
+
+#ifdef CONFIG_SHELL
+#define HOST_TRACE_USER_MAX	64
+
+/* Power on: S5 -> S0, PLTRST release, BIOS post codes, KBC init, ACPI, flash */
+static const struct host_trace_ev trace_boot[] = {
+	HOST_TRACE_EV(HOST_TRACE_VW, 0, 0, ESPI_VWIRE_SIGNAL_PLTRST),
+	HOST_TRACE_EV(HOST_TRACE_VW, 1, 0, ESPI_VWIRE_SIGNAL_SLP_S5),
+	HOST_TRACE_EV(HOST_TRACE_VW, 1, 0, ESPI_VWIRE_SIGNAL_SLP_S4),
+	HOST_TRACE_EV(HOST_TRACE_VW, 1, 0, ESPI_VWIRE_SIGNAL_SLP_S3),
+	HOST_TRACE_EV(HOST_TRACE_VW, 1, 0, ESPI_VWIRE_SIGNAL_PLTRST),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0x0),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0x40),
+	HOST_TRACE_EV(HOST_TRACE_P80, 0, 16, 0x10),
+	HOST_TRACE_EV(HOST_TRACE_KBC, 1, 1, 0xAA),
+	HOST_TRACE_EV(HOST_TRACE_KBC, 1, 1, 0x60),
+	HOST_TRACE_EV(HOST_TRACE_KBC, 0, 1, 0x47),
+	HOST_TRACE_EV(HOST_TRACE_P80, 0, 16, 0x90),
+	HOST_TRACE_EV(HOST_TRACE_ACPI, 1, 1, 0x80),
+	HOST_TRACE_EV(HOST_TRACE_ACPI, 0, 1, 0x00),
+	HOST_TRACE_EV(HOST_TRACE_P80, 0, 4, 0xA0),
+};
+
+/* Port 80 burst of every single byte code */
+static const struct host_trace_ev trace_p80[] = {
+	HOST_TRACE_EV(HOST_TRACE_P80, 0, 256, 0x00),
+};
+
+/* Keyboard typing, scan codes written to the data port */
+static const struct host_trace_ev trace_kbc[] = {
+	HOST_TRACE_EV(HOST_TRACE_KBC, 0, 64, 0x1C),
+	HOST_TRACE_EV(HOST_TRACE_ACPI, 1, 1, 0x80),
+	HOST_TRACE_EV(HOST_TRACE_ACPI, 0, 1, 0x00),
+};
+
+/* Sequential reads with an erase and write in between */
+static const struct host_trace_ev trace_flash[] = {
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0x0),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0x40),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0x80),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0xC0),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_ERASE, 0, 0x1000),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_WRITE, 64, 0x1000),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_WRITE, 64, 0x1040),
+	HOST_TRACE_EV(HOST_TRACE_FLASH, HOST_TRACE_FLASH_READ, 64, 0x1000),
+};
+
+static struct host_trace_ev trace_user[HOST_TRACE_USER_MAX];
+static size_t trace_user_num;
+
+static const struct {
+	const char *name;
+	const struct host_trace_ev *trace;
+	size_t num;
+} host_traces[] = {
+	{ "boot", trace_boot, ARRAY_SIZE(trace_boot) },
+	{ "p80", trace_p80, ARRAY_SIZE(trace_p80) },
+	{ "kbc", trace_kbc, ARRAY_SIZE(trace_kbc) },
+	{ "flash", trace_flash, ARRAY_SIZE(trace_flash) },
+};
+
+static const char *const host_trace_names[HOST_TRACE_TYPE_NUM] = {
+	"vw", "p80", "kbc", "acpi", "flash", "delay",
+};
+
+static const char *const host_trace_flash_ops[] = {
+	"read", "write", "erase",
+};
+
+static int host_trace_arg(const struct shell *shell, const char *arg, uint32_t *val)
+{
+	char *eptr;
+
+	*val = strtoul(arg, &eptr, 0);
+	if (*eptr != '\0') {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", arg);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int host_trace_play_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	const struct host_trace_ev *trace = trace_user;
+	size_t num = trace_user_num;
+	struct host_trace_stat stat;
+	uint32_t loops = 1, rate = 0;
+	int ret;
+
+	if (strcmp(argv[1], "user") != 0) {
+		num = 0;
+		for (size_t i = 0; i < ARRAY_SIZE(host_traces); i++) {
+			if (strcmp(argv[1], host_traces[i].name) == 0) {
+				trace = host_traces[i].trace;
+				num = host_traces[i].num;
+			}
+		}
+	}
+	if (num == 0) {
+		shell_error(shell, "Invalid argument, '%s' is not a trace", argv[1]);
+		return -EINVAL;
+	}
+	if (argc > 2 && host_trace_arg(shell, argv[2], &loops)) {
+		return -EINVAL;
+	}
+	if (argc > 3 && host_trace_arg(shell, argv[3], &rate)) {
+		return -EINVAL;
+	}
+
+	ret = host_trace_play(trace, num, loops, rate, &stat);
+	if (ret) {
+		shell_error(shell, "[FAIL] Host trace replay: %d, eSPI callbacks registered?",
+			    ret);
+		return ret;
+	}
+
+	shell_print(shell, "trace %s, %u loops, %u events in %u us", argv[1], loops,
+		    test_hist_count(&stat.lat), stat.elapsed_us);
+	for (int type = 0; type < HOST_TRACE_TYPE_NUM; type++) {
+		if (stat.events[type]) {
+			shell_print(shell, "  %-5s: %u", host_trace_names[type],
+				    stat.events[type]);
+		}
+	}
+	if (stat.elapsed_us) {
+		shell_print(shell, "  rate : %u events/s", (uint32_t)((uint64_t)
+			    test_hist_count(&stat.lat) * USEC_PER_SEC / stat.elapsed_us));
+	}
+#ifdef TEST_TIMING_HOST_TSC
+	shell_print(shell, "  delivery in host cycles: p50 %u, p99 %u, max %u",
+#else
+	shell_print(shell, "  delivery in cycles: p50 %u, p99 %u, max %u",
+#endif
+		    test_hist_percentile(&stat.lat, 50), test_hist_percentile(&stat.lat, 99),
+		    test_hist_max(&stat.lat));
+	shell_print(shell, "  unhandled: %u", stat.unhandled);
+
+	shell_info(shell, "[PASS] Host trace replay succeeded!");
+	return 0;
+}
+
+static int host_trace_add_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	struct host_trace_ev *ev = &trace_user[trace_user_num];
+	uint32_t val[3] = { 0 };
+	int type;
+
+	if (trace_user_num == ARRAY_SIZE(trace_user)) {
+		shell_error(shell, "User trace full, %d events", HOST_TRACE_USER_MAX);
+		return -ENOMEM;
+	}
+
+	for (type = 0; type < HOST_TRACE_TYPE_NUM; type++) {
+		if (strcmp(argv[1], host_trace_names[type]) == 0) {
+			break;
+		}
+	}
+	if (type == HOST_TRACE_TYPE_NUM) {
+		shell_error(shell, "Invalid argument, '%s' is not an event type", argv[1]);
+		return -EINVAL;
+	}
+
+	/* flash takes the operation name first, its other arguments are numbers */
+	for (size_t i = 2; i < argc; i++) {
+		if (type == HOST_TRACE_FLASH && i == 2) {
+			for (val[0] = 0; val[0] < ARRAY_SIZE(host_trace_flash_ops); val[0]++) {
+				if (strcmp(argv[i], host_trace_flash_ops[val[0]]) == 0) {
+					break;
+				}
+			}
+			if (val[0] == ARRAY_SIZE(host_trace_flash_ops)) {
+				shell_error(shell, "Invalid argument, '%s'", argv[i]);
+				return -EINVAL;
+			}
+		} else if (host_trace_arg(shell, argv[i], &val[i - 2])) {
+			return -EINVAL;
+		}
+	}
+
+	ev->type = type;
+	switch (type) {
+	case HOST_TRACE_VW:
+		ev->data = val[0];
+		ev->op = val[1];
+		ev->len = 1;
+		break;
+	case HOST_TRACE_FLASH:
+		ev->op = val[0];
+		ev->data = val[1];
+		ev->len = val[2];
+		break;
+	default:
+		/* p80/kbc/acpi: value [count] [cmd], delay: us */
+		ev->data = val[0];
+		ev->len = MAX(val[1], 1);
+		ev->op = val[2];
+		break;
+	}
+	trace_user_num++;
+
+	return 0;
+}
+
+static int host_trace_clear_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	trace_user_num = 0;
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_host_trace,
+	SHELL_CMD_ARG(play, NULL, "host_trace play <boot/p80/kbc/flash/user> [loops] [rate]: "
+		"replay a host trace, rate in events/s, 0 for back to back. TAF apps serve\n"
+		"  flash events from flash, nothing is completed on the bus",
+		host_trace_play_handler, 2, 2),
+	SHELL_CMD_ARG(add, NULL, "host_trace add <type> <args>: append to the user trace\n"
+		"  vw <signal> <level>\n"
+		"  p80 <code> [count]\n"
+		"  kbc/acpi <byte> [count] [cmd]\n"
+		"  flash <read/write/erase> <addr> <len/erase code>, TAF apps only\n"
+		"  delay <us>",
+		host_trace_add_handler, 3, 2),
+	SHELL_CMD(clear, NULL, "host_trace clear: empty the user trace", host_trace_clear_handler),
+	SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+SHELL_CMD_REGISTER(host_trace, &sub_host_trace, "Scripted eSPI host commands", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include "test_hist.h"
+
+void test_hist_reset(struct test_hist *hist)
+{
+	for (int i = 0; i < TEST_HIST_BINS; i++) {
+		atomic_clear(&hist->bins[i]);
+	}
+	atomic_clear(&hist->count);
+	atomic_clear(&hist->max);
+}
+
+void test_hist_add(struct test_hist *hist, uint32_t val)
+{
+	int bin = (val == 0) ? 0 : 32 - __builtin_clz(val);
+	atomic_val_t max;
+
+	atomic_inc(&hist->bins[bin]);
+	atomic_inc(&hist->count);
+
+	do {
+		max = atomic_get(&hist->max);
+		if ((uint32_t)max >= val) {
+			break;
+		}
+	} while (!atomic_cas(&hist->max, max, (atomic_val_t)val));
+}
+
+uint32_t test_hist_percentile(const struct test_hist *hist, uint32_t pct)
+{
+	uint32_t count = test_hist_count(hist);
+	uint32_t max = test_hist_max(hist);
+	uint32_t rank, sum = 0;
+
+	if (count == 0) {
+		return 0;
+	}
+
+	/* Rank of the sample, rounded up so p99 of a small set is its largest */
+	rank = (uint32_t)(((uint64_t)count * pct + 99U) / 100U);
+	rank = CLAMP(rank, 1, count);
+
+	for (int i = 0; i < TEST_HIST_BINS; i++) {
+		sum += (uint32_t)atomic_get(&hist->bins[i]);
+		if (sum >= rank) {
+			return (i == 0) ? 0 : MIN((uint32_t)BIT64_MASK(i), max);
+		}
+	}
+
+	return max;
+}
+
+#ifdef CONFIG_SHELL
+void test_hist_print(const struct shell *shell, const struct test_hist *hist)
+{
+	uint32_t n;
+
+	for (int i = 0; i < TEST_HIST_BINS; i++) {
+		n = (uint32_t)atomic_get(&hist->bins[i]);
+		if (n == 0) {
+			continue;
+		}
+		if (i == 0) {
+			shell_print(shell, "  =  0    | %u", n);
+		} else {
+			shell_print(shell, "  <  2^%-2d | %u", i, n);
+		}
+	}
+}
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2024 Nuvoton Technology Corporation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include "test_pattern.h"
+#include "test_timing.h"
+
+/* x^32 + x^22 + x^2 + x + 1 */
+#define TEST_PATTERN_LFSR_TAPS	0x80200003U
+#define TEST_PATTERN_WORD_SIZE	sizeof(uint32_t)
+
+static const char *const pattern_names[TEST_PATTERN_NUM] = {
+	[TEST_PATTERN_ADDR] = "addr",
+	[TEST_PATTERN_LFSR] = "lfsr",
+	[TEST_PATTERN_WALK1] = "walk1",
+	[TEST_PATTERN_CHECKER] = "checker",
+};
+
+static inline uint32_t test_pattern_lfsr_step(uint32_t lfsr)
+{
+	return (lfsr >> 1) ^ (-(lfsr & 1U) & TEST_PATTERN_LFSR_TAPS);
+}
+
+/*
+ * A step multiplies the state by x modulo the reciprocal polynomial, bit 31
+ * holding x^0. Multiply two states by Horner's rule, highest degree first.
+ */
+static uint32_t test_pattern_lfsr_mul(uint32_t a, uint32_t b)
+{
+	uint32_t r = 0;
+
+	for (int i = 0; i < 32; i++) {
+		r = test_pattern_lfsr_step(r);
+		if (b & BIT(i)) {
+			r ^= a;
+		}
+	}
+
+	return r;
+}
+
+/* State after n steps, state * x^n by square and multiply */
+static uint32_t test_pattern_lfsr_seek(uint32_t lfsr, uint32_t n)
+{
+	uint32_t x = BIT(30), xn = BIT(31);
+
+	for (; n != 0; n >>= 1) {
+		if (n & 1U) {
+			xn = test_pattern_lfsr_mul(xn, x);
+		}
+		x = test_pattern_lfsr_mul(x, x);
+	}
+
+	return test_pattern_lfsr_mul(lfsr, xn);
+}
+
+static inline uint32_t test_pattern_next(struct test_pattern *pat)
+{
+	uint32_t addr = pat->addr;
+	uint32_t word;
+
+	pat->addr += TEST_PATTERN_WORD_SIZE;
+
+	switch (pat->type) {
+	case TEST_PATTERN_LFSR:
+		word = pat->lfsr;
+		pat->lfsr = test_pattern_lfsr_step(pat->lfsr);
+		return word;
+	case TEST_PATTERN_WALK1:
+		return BIT(((addr / TEST_PATTERN_WORD_SIZE) + pat->seed) & 0x1F);
+	case TEST_PATTERN_CHECKER:
+		word = ((addr / TEST_PATTERN_WORD_SIZE) & 1U) ? 0xAAAAAAAAU : 0x55555555U;
+		return word ^ pat->seed;
+	case TEST_PATTERN_ADDR:
+	default:
+		return (addr * 2654435761U) ^ pat->seed;
+	}
+}
+
+void test_pattern_init(struct test_pattern *pat, enum test_pattern_type type,
+		       uint32_t seed, uint32_t addr)
+{
+	pat->type = type;
+	pat->seed = seed;
+	pat->addr = addr;
+	/* The stream starts at address 0, seek to the word of addr */
+	pat->lfsr = (seed != 0) ? seed : 1;
+	if (type == TEST_PATTERN_LFSR) {
+		pat->lfsr = test_pattern_lfsr_seek(pat->lfsr, addr / TEST_PATTERN_WORD_SIZE);
+	}
+}
+
+void test_pattern_fill(struct test_pattern *pat, void *buf, size_t len)
+{
+	uint8_t *ptr = buf;
+	uint32_t word;
+
+	while (len >= TEST_PATTERN_WORD_SIZE) {
+		word = test_pattern_next(pat);
+		memcpy(ptr, &word, TEST_PATTERN_WORD_SIZE);
+		ptr += TEST_PATTERN_WORD_SIZE;
+		len -= TEST_PATTERN_WORD_SIZE;
+	}
+
+	/* Tail bytes take the low bytes of the next word */
+	if (len) {
+		word = test_pattern_next(pat);
+		memcpy(ptr, &word, len);
+	}
+}
+
+uint32_t test_pattern_verify(struct test_pattern *pat, const void *buf, size_t len,
+			     uint32_t *err_addr)
+{
+	const uint8_t *ptr = buf;
+	uint32_t errors = 0;
+	uint32_t word, expect;
+
+	while (len) {
+		size_t sz = MIN(len, TEST_PATTERN_WORD_SIZE);
+
+		word = 0;
+		memcpy(&word, ptr, sz);
+		expect = test_pattern_next(pat);
+		if (sz < TEST_PATTERN_WORD_SIZE) {
+			expect &= BIT_MASK(sz * 8);
+		}
+
+		if (word != expect) {
+			if (errors++ == 0 && err_addr != NULL) {
+				*err_addr = pat->addr - TEST_PATTERN_WORD_SIZE;
+			}
+		}
+
+		ptr += sz;
+		len -= sz;
+	}
+
+	return errors;
+}
+
+const char *test_pattern_name(enum test_pattern_type type)
+{
+	if (type >= TEST_PATTERN_NUM) {
+		return "";
+	}
+
+	return pattern_names[type];
+}
+
+enum test_pattern_type test_pattern_from_name(const char *name)
+{
+	for (int i = 0; i < TEST_PATTERN_NUM; i++) {
+		if (!strcmp(pattern_names[i], name)) {
+			return i;
+		}
+	}
+
+	return TEST_PATTERN_NUM;
+}
+
+#ifdef CONFIG_SHELL
+#define PATTERN_BENCH_BUF_SIZE	4096
+
+static uint32_t pattern_bench_buf[PATTERN_BENCH_BUF_SIZE / sizeof(uint32_t)];
+
+static void pattern_bench_print(const struct shell *shell, const char *op, size_t size,
+				uint64_t cycles)
+{
+	uint32_t kbps = test_timing_kbps(size, cycles);
+
+	if (kbps == 0) {
+		shell_print(shell, "  %-6s: %u cycles/KB", op, (uint32_t)(cycles * 1024U / size));
+		return;
+	}
+
+	shell_print(shell, "  %-6s: %u cycles/KB, %u.%03u MB/s", op,
+		    (uint32_t)(cycles * 1024U / size), kbps / 1000U, kbps % 1000U);
+}
+
+static int pattern_bench_handler(const struct shell *shell, size_t argc, char **argv)
+{
+	struct test_pattern pat;
+	uint64_t fill_cycles, verify_cycles;
+	uint32_t start, errors, err_addr;
+	size_t size, len, offs;
+	char *eptr;
+	int first = 0, last = TEST_PATTERN_NUM - 1;
+
+	size = strtoul(argv[1], &eptr, 0);
+	if (*eptr != '\0' || size == 0) {
+		shell_error(shell, "Invalid argument, '%s' is not an integer", argv[1]);
+		return -EINVAL;
+	}
+
+	if (argc > 2) {
+		first = last = test_pattern_from_name(argv[2]);
+		if (first == TEST_PATTERN_NUM) {
+			shell_error(shell, "Invalid argument, '%s' is not a pattern", argv[2]);
+			return -EINVAL;
+		}
+	}
+
+	for (int type = first; type <= last; type++) {
+		fill_cycles = 0;
+		verify_cycles = 0;
+		errors = 0;
+
+		/* Regenerate and check the same buffer, the region itself never exists */
+		for (offs = 0; offs < size; offs += len) {
+			len = MIN(size - offs, sizeof(pattern_bench_buf));
+
+			test_pattern_init(&pat, type, 0, offs);
+			start = test_timing_cycles();
+			test_pattern_fill(&pat, pattern_bench_buf, len);
+			fill_cycles += test_timing_cycles() - start;
+
+			test_pattern_init(&pat, type, 0, offs);
+			start = test_timing_cycles();
+			errors += test_pattern_verify(&pat, pattern_bench_buf, len, &err_addr);
+			verify_cycles += test_timing_cycles() - start;
+		}
+
+		shell_print(shell, "pattern %s, %u bytes", test_pattern_name(type), size);
+		pattern_bench_print(shell, "fill", size, fill_cycles);
+		pattern_bench_print(shell, "verify", size, verify_cycles);
+		if (errors != 0) {
+			shell_error(shell, "[FAIL] pattern %s verify, first error 0x%x",
+				    test_pattern_name(type), err_addr);
+			return 0;
+		}
+	}
+
+	shell_info(shell, "[PASS] Pattern bench succeeded!");
+	shell_info(shell, "[GO]");
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_pattern,
+	SHELL_CMD_ARG(bench, NULL, "pattern bench <size> [addr/lfsr/walk1/checker]: "
+		"pattern fill and verify throughput",
+		pattern_bench_handler, 2, 1),
+	SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+SHELL_CMD_REGISTER(pattern, &sub_pattern, "Test pattern commands", NULL);
+#endif /* CONFIG_SHELL */